@@ -0,0 +1,79 @@
+// BSD 3-Clause License
+// 
+// Copyright (c) 2023, Roy Ward
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Latency of single variates, poisson_random_variate_integer against poisson_random_variate_integer_bounded.
+// Each call is timed on its own, so the times include the clock overhead, but the tail is what matters here.
+
+#include "poisson_random_variate_integer.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+static const uint32_t ITERATIONS=1000000;
+static const uint32_t MAX_TRIALS=2;
+
+static void report(const char* name, double lambda, vector<uint32_t>& ns) {
+	sort(ns.begin(),ns.end());
+	cout << setw(8) << lambda << ' ' << setw(8) << name;
+	for(double q : {0.5,0.99,0.999,0.9999}) {
+		cout << setw(8) << ns[(size_t)(q*ns.size())];
+	}
+	cout << setw(8) << ns.back() << endl;
+}
+
+int main() {
+	uint64_t seed=1234123452347;
+	vector<uint32_t> ns(ITERATIONS);
+	uint64_t total=0;
+	cout << "  lambda     mode     p50     p99   p99.9  p99.99     max (ns)" << endl;
+	for(double lambda : {5.0,30.0,100.0,10000.0}) {
+		int64_t fixed_lambda=(int64_t)(lambda*4294967296.0);
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			auto start=chrono::steady_clock::now();
+			total+=poisson_random_variate_integer(&seed,fixed_lambda);
+			ns[i]=(uint32_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-start).count();
+		}
+		report("default",lambda,ns);
+		poisson_random_variate_table* table=poisson_random_variate_table_create(fixed_lambda);
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			auto start=chrono::steady_clock::now();
+			total+=poisson_random_variate_integer_bounded(&seed,table,MAX_TRIALS);
+			ns[i]=(uint32_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-start).count();
+		}
+		report("bounded",lambda,ns);
+		poisson_random_variate_table_destroy(table);
+	}
+	// keeps the calls from being optimized away
+	cout << total << endl;
+	return 0;
+}
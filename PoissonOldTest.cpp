@@ -0,0 +1,138 @@
+// BSD 3-Clause License
+// 
+// Copyright (c) 2023, Roy Ward
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Checks that poisson_random_variate_old.c still gives exactly the 1.0.0 results, for the single variate
+// function and the fill and streams versions. 1.0.0 gave different results on different processors, so
+// the golden values are per processor type.
+
+#include "poisson_random_variate_old.h"
+#include <iostream>
+
+using namespace std;
+
+static const uint32_t ITERATIONS=1000;
+
+struct golden {
+	double lambda;
+	uint64_t hash;
+};
+
+// hashes of ITERATIONS variates from seed 1234123452347, then of ITERATIONS streams (see check_streams)
+#if __x86_64 || _M_X64
+static const golden GOLDEN[]={
+	{0.5,0xd7c654c3a06a94c6ULL},
+	{5,0xd70332ee86da708aULL},
+	{17.5,0xfd7e7d134717388cULL},
+	{30,0x20b11932e5b9dd01ULL},
+	{100,0x085fb48b0c157d80ULL},
+	{400,0x54f87728571312d1ULL},
+};
+static const uint64_t GOLDEN_STREAMS=0xa201ff751759e7c3ULL;
+#elif __aarch64__
+// unchecked: the NEON results of 1.0.0 have never been recorded, so this test checks nothing on aarch64
+static const golden GOLDEN[]={{0,0}};
+static const uint64_t GOLDEN_STREAMS=0;
+#define NO_GOLDEN
+#else
+static const golden GOLDEN[]={
+	{0.5,0xd7c654c3a06a94c6ULL},
+	{5,0xd70332ee86da708aULL},
+	{17.5,0xaa978a310b481be8ULL},
+	{30,0x7ba12105981b1bc0ULL},
+	{100,0x787557c89325f6bcULL},
+	{400,0x04d05a3a199b4239ULL},
+};
+static const uint64_t GOLDEN_STREAMS=0x6c649646778529c6ULL;
+#endif
+
+static uint64_t hash_add(uint64_t hash, uint32_t x) {
+	return (hash^x)*1099511628211ULL;
+}
+
+static bool check(const char* name, double lambda, uint64_t hash, uint64_t expected) {
+	if(hash!=expected) {
+		cout << name << " differs from 1.0.0 for lambda " << lambda << endl;
+		return false;
+	}
+	return true;
+}
+
+static bool check_single(const golden& g) {
+	uint64_t seed=1234123452347;
+	uint64_t hash=1469598103934665603ULL;
+	for(uint32_t i=0;i<ITERATIONS;i++) {
+		hash=hash_add(hash,poisson_random_variable_fixed_int(&seed,(int64_t)(g.lambda*4294967296.0)));
+	}
+	return check("poisson_random_variable_fixed_int",g.lambda,hash,g.hash);
+}
+
+static bool check_fill(const golden& g) {
+	uint64_t seed=1234123452347;
+	uint64_t hash=1469598103934665603ULL;
+	uint32_t out[ITERATIONS];
+	poisson_random_variable_fixed_int_fill(&seed,(int64_t)(g.lambda*4294967296.0),out,ITERATIONS);
+	for(uint32_t i=0;i<ITERATIONS;i++) {
+		hash=hash_add(hash,out[i]);
+	}
+	return check("poisson_random_variable_fixed_int_fill",g.lambda,hash,g.hash);
+}
+
+// item i has lambda (i%97)/2 and its own seed, and both the results and the seeds afterwards are hashed
+static bool check_streams() {
+	uint64_t seeds[ITERATIONS];
+	int64_t lambdas[ITERATIONS];
+	uint32_t out[ITERATIONS];
+	for(uint32_t i=0;i<ITERATIONS;i++) {
+		seeds[i]=1234123452347ULL+i*0x9e3779b97f4a7c15ULL;
+		lambdas[i]=(int64_t)(i%97)*2147483648LL;
+	}
+	poisson_random_variable_fixed_int_streams(seeds,lambdas,out,ITERATIONS);
+	uint64_t hash=1469598103934665603ULL;
+	for(uint32_t i=0;i<ITERATIONS;i++) {
+		hash=hash_add(hash,out[i]);
+		hash=hash_add(hash,(uint32_t)seeds[i]);
+	}
+	return check("poisson_random_variable_fixed_int_streams",0,hash,GOLDEN_STREAMS);
+}
+
+int main() {
+#ifdef NO_GOLDEN
+	cout << "unchecked: no 1.0.0 golden values for this processor" << endl;
+	return 0;
+#else
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		ok&=check_single(g);
+		ok&=check_fill(g);
+	}
+	ok&=check_streams();
+	cout << (ok?"1.0.0 results match":"1.0.0 results differ") << endl;
+	return ok?0:1;
+#endif
+}
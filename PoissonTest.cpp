@@ -28,6 +28,11 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "poisson_random_variate_integer.h"
+#include "poisson_random_variate_buffer.h"
+#include "poisson_random_variate_tiles.h"
+#if __cplusplus>=202002L
+#include "poisson_random_variate_view.h"
+#endif
 #include <iostream>
 #include <iomanip>
 #include <cstring>
@@ -37,7 +42,573 @@ using namespace std;
 static const uint32_t ITERATIONS=10000;
 static const uint32_t MAX=10000;
 
+// hashes of ITERATIONS variates from seed 1234123452347, as given by the 2.0.0 release, which the faster
+// acceptance tests added since must not change
+struct golden {
+	double lambda;
+	uint64_t hash;
+};
+
+static const golden GOLDEN[]={
+	{0,0x9217a97c29270043ULL},
+	{0.5,0x7d00da8f0e5004bdULL},
+	{5,0x69f6b0875ecd4694ULL},
+	{17.5,0xeffa93bf43ad55faULL},
+	{18.5,0x486577f85607e050ULL},
+	{30,0xc7ca0643aeaefb44ULL},
+	{38.5,0x330d18a171b16c3cULL},
+	{50,0x7af876a99141def9ULL},
+	{100,0x8faeac34d6a8236bULL},
+	{255.5,0x60aaac5124c6429fULL},
+	{300,0x93861abbeee7c3e2ULL},
+	{1000,0x7944cc3f61a69c62ULL},
+	{100000,0x4f343c8eeaefe04fULL},
+};
+
+static uint64_t hash_add(uint64_t hash, uint32_t x) {
+	return (hash^x)*1099511628211ULL;
+}
+
+static bool check_golden() {
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		uint64_t seed=1234123452347;
+		uint64_t hash=1469598103934665603ULL;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			hash=hash_add(hash,poisson_random_variate_integer(&seed,(int64_t)(g.lambda*4294967296.0)));
+		}
+		if(hash!=g.hash) {
+			cout << "golden values differ for lambda " << g.lambda << endl;
+			ok=false;
+		}
+	}
+	return ok;
+}
+
+// the fill versions must give the same values, and leave the same seed, as single calls
+static bool check_fill() {
+	static uint32_t expected[ITERATIONS];
+	static uint32_t out[ITERATIONS];
+	static uint16_t out16[ITERATIONS];
+	static uint8_t out8[ITERATIONS];
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		int64_t lambda=(int64_t)(g.lambda*4294967296.0);
+		uint64_t seed=1234123452347;
+		size_t saturated16=0;
+		size_t saturated8=0;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			expected[i]=poisson_random_variate_integer(&seed,lambda);
+			saturated16+=expected[i]>0xFFFF;
+			saturated8+=expected[i]>0xFF;
+		}
+		uint64_t seed_fill=1234123452347;
+		uint64_t seed16=1234123452347;
+		uint64_t seed8=1234123452347;
+		poisson_random_variate_integer_fill(&seed_fill,lambda,out,ITERATIONS);
+		bool same16=poisson_random_variate_integer_fill_u16(&seed16,lambda,out16,ITERATIONS)==saturated16;
+		bool same8=poisson_random_variate_integer_fill_u8(&seed8,lambda,out8,ITERATIONS)==saturated8;
+		bool same=true;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			same&=out[i]==expected[i];
+			same16&=out16[i]==(expected[i]>0xFFFF?0xFFFF:expected[i]);
+			same8&=out8[i]==(expected[i]>0xFF?0xFF:expected[i]);
+		}
+		if(!same || seed_fill!=seed) {
+			cout << "poisson_random_variate_integer_fill differs for lambda " << g.lambda << endl;
+			ok=false;
+		}
+		if(!same16 || seed16!=seed) {
+			cout << "poisson_random_variate_integer_fill_u16 differs for lambda " << g.lambda << endl;
+			ok=false;
+		}
+		if(!same8 || seed8!=seed) {
+			cout << "poisson_random_variate_integer_fill_u8 differs for lambda " << g.lambda << endl;
+			ok=false;
+		}
+	}
+	return ok;
+}
+
+// the approximate mode's fill must match single calls, and below the threshold both must be exact
+static bool check_approx() {
+	static const int64_t THRESHOLDS[]={50LL<<32,1LL<<52};
+	static uint32_t out[ITERATIONS];
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		int64_t lambda=(int64_t)(g.lambda*4294967296.0);
+		for(int64_t threshold : THRESHOLDS) {
+			uint64_t seed=1234123452347;
+			uint64_t seed_fill=1234123452347;
+			poisson_random_variate_integer_approx_fill(&seed_fill,lambda,threshold,out,ITERATIONS);
+			uint64_t hash=1469598103934665603ULL;
+			bool same=true;
+			for(uint32_t i=0;i<ITERATIONS;i++) {
+				uint32_t p=poisson_random_variate_integer_approx(&seed,lambda,threshold);
+				hash=hash_add(hash,p);
+				same&=out[i]==p;
+			}
+			if(!same || seed_fill!=seed) {
+				cout << "poisson_random_variate_integer_approx_fill differs for lambda " << g.lambda << endl;
+				ok=false;
+			}
+			if(lambda<threshold && hash!=g.hash) {
+				cout << "poisson_random_variate_integer_approx below the threshold differs for lambda " << g.lambda << endl;
+				ok=false;
+			}
+		}
+	}
+	return ok;
+}
+
+// the negative binomial fill must match single calls, and shapes below 2^-16 must act as 2^-16
+static bool check_negative_binomial() {
+	static const int64_t SHAPES[]={1LL<<16,1LL<<31,3LL<<32};
+	static uint32_t out[ITERATIONS];
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		int64_t mean=(int64_t)(g.lambda*4294967296.0);
+		for(int64_t shape : SHAPES) {
+			uint64_t seed=1234123452347;
+			uint64_t seed_fill=1234123452347;
+			poisson_random_variate_negative_binomial_fill(&seed_fill,mean,shape,out,ITERATIONS);
+			bool same=true;
+			for(uint32_t i=0;i<ITERATIONS;i++) {
+				same&=out[i]==poisson_random_variate_negative_binomial(&seed,mean,shape);
+			}
+			if(!same || seed_fill!=seed) {
+				cout << "poisson_random_variate_negative_binomial_fill differs for mean " << g.lambda << endl;
+				ok=false;
+			}
+		}
+		uint64_t seed_tiny=1234123452347;
+		uint64_t seed_min=1234123452347;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			if(poisson_random_variate_negative_binomial(&seed_tiny,mean,1)!=poisson_random_variate_negative_binomial(&seed_min,mean,1LL<<16)) {
+				cout << "poisson_random_variate_negative_binomial doesn't clamp the shape for mean " << g.lambda << endl;
+				ok=false;
+				break;
+			}
+		}
+	}
+	return ok;
+}
+
+// the default thresholds must give exactly poisson_random_variate_integer, and thresholds out of range must
+// be clamped rather than sending small lambdas to PTRD
+static bool check_tuned() {
+	static uint32_t out[ITERATIONS];
+	poisson_random_variate_thresholds t;
+	poisson_random_variate_thresholds_default(&t);
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		int64_t lambda=(int64_t)(g.lambda*4294967296.0);
+		uint64_t seed=1234123452347;
+		uint64_t hash=1469598103934665603ULL;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			hash=hash_add(hash,poisson_random_variate_integer_tuned(&seed,lambda,&t));
+		}
+		uint64_t seed_fill=1234123452347;
+		uint64_t hash_fill=1469598103934665603ULL;
+		poisson_random_variate_integer_tuned_fill(&seed_fill,lambda,&t,out,ITERATIONS);
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			hash_fill=hash_add(hash_fill,out[i]);
+		}
+		if(hash!=g.hash || hash_fill!=g.hash || seed_fill!=seed) {
+			cout << "poisson_random_variate_integer_tuned with the default thresholds differs for lambda " << g.lambda << endl;
+			ok=false;
+		}
+	}
+	poisson_random_variate_thresholds low={0,5LL<<32};
+	poisson_random_variate_thresholds clamped={0,10LL<<32};
+	uint64_t seed_low=1234123452347;
+	uint64_t seed_clamped=1234123452347;
+	for(uint32_t i=0;i<ITERATIONS;i++) {
+		if(poisson_random_variate_integer_tuned(&seed_low,7LL<<32,&low)!=poisson_random_variate_integer_tuned(&seed_clamped,7LL<<32,&clamped)) {
+			cout << "poisson_random_variate_integer_tuned doesn't clamp mid_max" << endl;
+			ok=false;
+			break;
+		}
+	}
+	return ok;
+}
+
+// the bounded fill must match single calls. Above 38 with trials to spare it must be exactly
+// poisson_random_variate_integer, and the table must give 0 for lambda<=0.
+static bool check_bounded() {
+	static const uint32_t MAX_TRIALS[]={0,1,0xFFFFFFFF};
+	static uint32_t out[ITERATIONS];
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		int64_t lambda=(int64_t)(g.lambda*4294967296.0);
+		poisson_random_variate_table* table=poisson_random_variate_table_create(lambda);
+		for(uint32_t max_trials : MAX_TRIALS) {
+			uint64_t seed=1234123452347;
+			uint64_t seed_fill=1234123452347;
+			poisson_random_variate_integer_bounded_fill(&seed_fill,table,max_trials,out,ITERATIONS);
+			uint64_t hash=1469598103934665603ULL;
+			bool same=true;
+			for(uint32_t i=0;i<ITERATIONS;i++) {
+				uint32_t p=poisson_random_variate_integer_bounded(&seed,table,max_trials);
+				hash=hash_add(hash,p);
+				same&=out[i]==p;
+			}
+			if(!same || seed_fill!=seed) {
+				cout << "poisson_random_variate_integer_bounded_fill differs for lambda " << g.lambda << endl;
+				ok=false;
+			}
+			if(g.lambda>38 && max_trials==0xFFFFFFFF && hash!=g.hash) {
+				cout << "poisson_random_variate_integer_bounded differs from poisson_random_variate_integer for lambda " << g.lambda << endl;
+				ok=false;
+			}
+		}
+		poisson_random_variate_table_destroy(table);
+	}
+	static const int64_t NON_POSITIVE[]={0,-1,-(1LL<<40)};
+	for(int64_t lambda : NON_POSITIVE) {
+		poisson_random_variate_table* table=poisson_random_variate_table_create(lambda);
+		uint64_t seed=1234123452347;
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			if(poisson_random_variate_table_sample(&seed,table)!=0) {
+				cout << "poisson_random_variate_table_sample isn't 0 for lambda " << lambda << endl;
+				ok=false;
+				break;
+			}
+		}
+		poisson_random_variate_table_destroy(table);
+	}
+	return ok;
+}
+
+// fixed consumption: generating a stream in chunks, each starting from a skipped copy of the seed as separate
+// threads would, must give exactly the fill's values and final seed, and words=0 must be the same as words=1
+static bool check_fixed() {
+	static const uint32_t WORDS[]={0,1,3,8};
+	static const uint32_t CHUNK_START[]={0,1,777,5000,ITERATIONS};
+	static uint32_t expected[ITERATIONS];
+	static uint32_t out[ITERATIONS];
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		poisson_random_variate_table* table=poisson_random_variate_table_create((int64_t)(g.lambda*4294967296.0));
+		for(uint32_t words : WORDS) {
+			uint64_t seed=1234123452347;
+			poisson_random_variate_integer_fixed_fill(&seed,table,words,expected,ITERATIONS);
+			uint64_t chunk_seed=0;
+			for(uint32_t c=0;c+1<sizeof(CHUNK_START)/sizeof(CHUNK_START[0]);c++) {
+				chunk_seed=1234123452347;
+				poisson_random_variate_skip(&chunk_seed,CHUNK_START[c],words);
+				for(uint32_t i=CHUNK_START[c];i<CHUNK_START[c+1];i++) {
+					out[i]=poisson_random_variate_integer_fixed(&chunk_seed,table,words);
+				}
+			}
+			bool same=(chunk_seed==seed);
+			for(uint32_t i=0;i<ITERATIONS;i++) {
+				same&=out[i]==expected[i];
+			}
+			if(words==0) {
+				uint64_t seed1=1234123452347;
+				poisson_random_variate_integer_fixed_fill(&seed1,table,1,out,ITERATIONS);
+				same&=(seed1==seed);
+				for(uint32_t i=0;i<ITERATIONS;i++) {
+					same&=out[i]==expected[i];
+				}
+			}
+			if(!same) {
+				cout << "poisson_random_variate_integer_fixed with skip differs for lambda " << g.lambda << " and words " << words << endl;
+				ok=false;
+			}
+		}
+		poisson_random_variate_table_destroy(table);
+	}
+	return ok;
+}
+
+// every stream must give the values, and leave the seed, of single calls with its own seed and lambda. Lambdas
+// go through all the regimes, mixed so that neighbouring items take different paths.
+static const uint32_t STREAMS=1000;
+
+static void streams_setup(uint64_t* seeds, int64_t* lambdas) {
+	for(uint32_t i=0;i<STREAMS;i++) {
+		seeds[i]=1234123452347ULL+i*0x9e3779b97f4a7c15ULL;
+		lambdas[i]=(int64_t)((i*37)%401)*2147483648LL;
+	}
+	lambdas[STREAMS-1]=-1;
+}
+
+static bool check_streams() {
+	static uint64_t seeds[STREAMS];
+	static int64_t lambdas[STREAMS];
+	static uint32_t out[STREAMS];
+	streams_setup(seeds,lambdas);
+	poisson_random_variate_integer_streams(seeds,lambdas,out,STREAMS);
+	bool ok=true;
+	for(uint32_t i=0;i<STREAMS;i++) {
+		uint64_t seed=1234123452347ULL+i*0x9e3779b97f4a7c15ULL;
+		uint32_t p=poisson_random_variate_integer(&seed,lambdas[i]);
+		if(out[i]!=p || seeds[i]!=seed) {
+			cout << "poisson_random_variate_integer_streams differs for item " << i << endl;
+			ok=false;
+		}
+	}
+	return ok;
+}
+
+// strided streams over an array of structs must match the plain streams, and with seed_stride 0 they must
+// match single calls using one seed in turn
+struct stream_item {
+	uint64_t seed;
+	int64_t lambda;
+	double lambda_double;
+	uint32_t out;
+	uint32_t out_double;
+};
+
+static bool check_streams_strided() {
+	static uint64_t seeds[STREAMS];
+	static int64_t lambdas[STREAMS];
+	static uint32_t out[STREAMS];
+	static stream_item items[STREAMS];
+	streams_setup(seeds,lambdas);
+	for(uint32_t i=0;i<STREAMS;i++) {
+		items[i].seed=seeds[i];
+		items[i].lambda=lambdas[i];
+		items[i].lambda_double=lambdas[i]/4294967296.0;
+	}
+	poisson_random_variate_integer_streams(seeds,lambdas,out,STREAMS);
+	poisson_random_variate_integer_streams_strided(&items[0].seed,sizeof(stream_item),&items[0].lambda,sizeof(stream_item),&items[0].out,sizeof(stream_item),STREAMS);
+	bool ok=true;
+	for(uint32_t i=0;i<STREAMS;i++) {
+		if(items[i].out!=out[i] || items[i].seed!=seeds[i]) {
+			cout << "poisson_random_variate_integer_streams_strided differs for item " << i << endl;
+			ok=false;
+		}
+		items[i].seed=1234123452347ULL+i*0x9e3779b97f4a7c15ULL;
+	}
+	poisson_random_variate_integer_streams_strided_double(&items[0].seed,sizeof(stream_item),&items[0].lambda_double,sizeof(stream_item),&items[0].out_double,sizeof(stream_item),STREAMS);
+	for(uint32_t i=0;i<STREAMS;i++) {
+		if(items[i].out_double!=out[i] || items[i].seed!=seeds[i]) {
+			cout << "poisson_random_variate_integer_streams_strided_double differs for item " << i << endl;
+			ok=false;
+		}
+	}
+	uint64_t seed=1234123452347;
+	uint64_t seed_shared=1234123452347;
+	poisson_random_variate_integer_streams_strided(&seed_shared,0,&items[0].lambda,sizeof(stream_item),&items[0].out,sizeof(stream_item),STREAMS);
+	for(uint32_t i=0;i<STREAMS;i++) {
+		if(items[i].out!=poisson_random_variate_integer(&seed,items[i].lambda)) {
+			cout << "poisson_random_variate_integer_streams_strided with one seed differs for item " << i << endl;
+			ok=false;
+		}
+	}
+	if(seed_shared!=seed) {
+		cout << "poisson_random_variate_integer_streams_strided with one seed leaves a different seed" << endl;
+		ok=false;
+	}
+	return ok;
+}
+
+// ring i of the buffer must pop exactly the fill of poisson_random_variate_derive_seed(seed,i), wrapping round
+// the ring many times, whatever the producer's timing
+static bool check_buffer() {
+	static const int64_t LAMBDAS[]={0,5LL<<32,30LL<<32,300LL<<32};
+	static const uint32_t RINGS=sizeof(LAMBDAS)/sizeof(LAMBDAS[0]);
+	static uint32_t expected[ITERATIONS];
+	if(poisson_random_variate_buffer_create(1234123452347,LAMBDAS,RINGS,0x80000001U)!=NULL) {
+		cout << "poisson_random_variate_buffer_create accepts a capacity above 2^31" << endl;
+		return false;
+	}
+	poisson_random_variate_buffer* buffer=poisson_random_variate_buffer_create(1234123452347,LAMBDAS,RINGS,64);
+	bool ok=true;
+	for(uint32_t r=0;r<RINGS;r++) {
+		uint64_t seed=poisson_random_variate_derive_seed(1234123452347,r);
+		poisson_random_variate_integer_fill(&seed,LAMBDAS[r],expected,ITERATIONS);
+		for(uint32_t i=0;i<ITERATIONS;i++) {
+			if(poisson_random_variate_buffer_pop(buffer,r)!=expected[i]) {
+				cout << "poisson_random_variate_buffer_pop differs from the fill for ring " << r << endl;
+				ok=false;
+				break;
+			}
+		}
+	}
+	poisson_random_variate_buffer_destroy(buffer);
+	return ok;
+}
+
+#if __cplusplus>=202002L
+// the view must give the single calls' values, across many of its blocks
+static bool check_view() {
+	bool ok=true;
+	for(const golden& g : GOLDEN) {
+		uint64_t hash=1469598103934665603ULL;
+		for(uint32_t x : poisson_view(1234123452347,(int64_t)(g.lambda*4294967296.0)) | std::views::take(ITERATIONS)) {
+			hash=hash_add(hash,x);
+		}
+		if(hash!=g.hash) {
+			cout << "poisson_view differs from single calls for lambda " << g.lambda << endl;
+			ok=false;
+		}
+	}
+	return ok;
+}
+#endif
+
+// arrival times must be non-decreasing (count-1 also ends on a few scalar logs after the vector ones) and
+// the same, as must the seed afterwards, every time from the same seed
+static bool check_arrivals() {
+	static const double LAMBDAS[]={0.01,0.5,5,1000};
+	static const uint32_t COUNT=ITERATIONS-1;
+	static uint64_t times[COUNT];
+	static uint64_t again[COUNT];
+	bool ok=true;
+	for(double l : LAMBDAS) {
+		int64_t lambda=(int64_t)(l*4294967296.0);
+		uint64_t seed=1234123452347;
+		uint64_t seed_again=1234123452347;
+		poisson_random_variate_arrivals(&seed,lambda,times,COUNT);
+		poisson_random_variate_arrivals(&seed_again,lambda,again,COUNT);
+		bool same=(seed==seed_again);
+		for(uint32_t i=0;i<COUNT;i++) {
+			same&=times[i]==again[i] && (i==0 || times[i-1]<=times[i]);
+		}
+		// arrivals in the first half of that time: all stored, or only counted
+		uint64_t end=times[COUNT/2];
+		seed=1234123452347;
+		seed_again=1234123452347;
+		uint32_t n=poisson_random_variate_arrivals_until(&seed,lambda,end,times,COUNT);
+		same&=(n<COUNT) && (poisson_random_variate_arrivals_until(&seed_again,lambda,end,again,0)==n) && (seed==seed_again);
+		for(uint32_t i=0;i<n && i<COUNT;i++) {
+			same&=times[i]<end && (i==0 || times[i-1]<=times[i]);
+		}
+		if(!same) {
+			cout << "poisson_random_variate_arrivals isn't reproducible and in order for lambda " << l << endl;
+			ok=false;
+		}
+	}
+	return ok;
+}
+
+// the histogram must always count exactly the draws asked for, whatever the bins, and must leave hist alone
+// when it rejects the arguments
+static bool check_histogram() {
+	static const double LAMBDAS[]={0,0.5,30,1000};
+	static const uint64_t DRAWS[]={0,1,1000,1000000000};
+	static const uint32_t HIST_SIZE[]={1,10,64};
+	uint64_t hist[64];
+	bool ok=true;
+	for(double l : LAMBDAS) {
+		for(uint64_t draws : DRAWS) {
+			for(uint32_t hist_size : HIST_SIZE) {
+				uint64_t seed=1234123452347;
+				uint64_t total=0;
+				if(poisson_random_variate_integer_histogram(&seed,(int64_t)(l*4294967296.0),draws,hist,hist_size)!=0) {
+					total=~0ULL;
+				}
+				for(uint32_t i=0;i<hist_size && total!=~0ULL;i++) {
+					total+=hist[i];
+				}
+				if(total!=draws) {
+					cout << "poisson_random_variate_integer_histogram doesn't count " << draws << " draws for lambda " << l << " and " << hist_size << " bins" << endl;
+					ok=false;
+				}
+			}
+		}
+	}
+	uint64_t seed=1234123452347;
+	hist[0]=7;
+	if(poisson_random_variate_integer_histogram(&seed,5LL<<32,10,hist,0)!=-1 || poisson_random_variate_integer_histogram(&seed,5LL<<32,1ULL<<48,hist,64)!=-1 || hist[0]!=7) {
+		cout << "poisson_random_variate_integer_histogram accepts 0 bins or 2^48 draws" << endl;
+		ok=false;
+	}
+	return ok;
+}
+
+static const uint32_t TILE_WIDTH=16;
+static const uint32_t TILE_HEIGHT=8;
+
+// lambdas from 0 up to 100000, so that the compressed counts take from 1 to 3 bytes
+static void tiles_lambdas(void*, int64_t x, int64_t y, int64_t* lambdas) {
+	for(uint32_t i=0;i<TILE_WIDTH*TILE_HEIGHT;i++) {
+		lambdas[i]=(((x*7+y*3+i)%5==0)?100000:(int64_t)(i%40))<<32;
+	}
+}
+
+// a tile that is compressed and brought back, or dropped and generated again, must be byte identical to the
+// first time, and both must be the tile's own stream
+static bool check_tiles() {
+	static const uint64_t COLD_BYTES[]={0,1<<20};
+	static uint32_t first[TILE_WIDTH*TILE_HEIGHT];
+	bool ok=true;
+	for(uint64_t cold_bytes : COLD_BYTES) {
+		for(bool per_cell : {false,true}) {
+			poisson_random_variate_tiles_config config={1234123452347,30LL<<32,per_cell?tiles_lambdas:NULL,NULL,TILE_WIDTH,TILE_HEIGHT,1,cold_bytes};
+			poisson_random_variate_tiles* tiles=poisson_random_variate_tiles_create(&config);
+			memcpy(first,poisson_random_variate_tiles_get(tiles,3,-5),sizeof(first));
+			poisson_random_variate_tiles_get(tiles,-1,2);
+			const uint32_t* again=poisson_random_variate_tiles_get(tiles,3,-5);
+			poisson_random_variate_tiles_stats stats;
+			poisson_random_variate_tiles_get_stats(tiles,&stats);
+			bool same=memcmp(first,again,sizeof(first))==0 && stats.cold_hits==(cold_bytes?1:0) && stats.misses==(cold_bytes?2:3);
+			if(!per_cell) {
+				uint64_t seed=poisson_random_variate_derive_seed(poisson_random_variate_derive_seed(1234123452347,3),(uint64_t)-5);
+				for(uint32_t i=0;i<TILE_WIDTH*TILE_HEIGHT;i++) {
+					same&=first[i]==poisson_random_variate_integer(&seed,30LL<<32);
+				}
+			}
+			poisson_random_variate_tiles_destroy(tiles);
+			if(!same) {
+				cout << "poisson_random_variate_tiles_get differs after eviction with cold_bytes " << cold_bytes << (per_cell?" and per cell lambdas":"") << endl;
+				ok=false;
+			}
+		}
+	}
+	return ok;
+}
+
 int main() {
+	if(!check_golden()) {
+		return 1;
+	}
+	if(!check_fill()) {
+		return 1;
+	}
+	if(!check_approx()) {
+		return 1;
+	}
+	if(!check_negative_binomial()) {
+		return 1;
+	}
+	if(!check_tuned()) {
+		return 1;
+	}
+	if(!check_bounded()) {
+		return 1;
+	}
+	if(!check_fixed()) {
+		return 1;
+	}
+	if(!check_streams()) {
+		return 1;
+	}
+	if(!check_streams_strided()) {
+		return 1;
+	}
+	if(!check_buffer()) {
+		return 1;
+	}
+#if __cplusplus>=202002L
+	if(!check_view()) {
+		return 1;
+	}
+#endif
+	if(!check_arrivals()) {
+		return 1;
+	}
+	if(!check_histogram()) {
+		return 1;
+	}
+	if(!check_tiles()) {
+		return 1;
+	}
 	uint64_t seed=1234123452347;
 	uint32_t* hist1=new uint32_t[MAX];
 	for(uint64_t lambda=0;lambda<100;lambda+=1) {
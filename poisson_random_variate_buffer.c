@@ -0,0 +1,177 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "poisson_random_variate_buffer.h"
+#include "poisson_random_variate_integer.h"
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// the largest power of 2 that fits in a uint32_t
+static const uint32_t MAX_CAPACITY=1U<<31;
+
+struct alignas(64) poisson_ring {
+	// producer side
+	alignas(64) std::atomic<uint64_t> head;
+	uint64_t seed;
+	int64_t lambda;
+	// consumer side
+	alignas(64) std::atomic<uint64_t> tail;
+	std::atomic<uint32_t> low_water;
+	std::atomic<uint64_t> underruns;
+	// shared, read only after creation
+	alignas(64) uint32_t* data;
+	uint32_t capacity;
+};
+
+struct poisson_random_variate_buffer {
+	poisson_ring* rings;
+	uint32_t ring_count;
+	std::atomic<bool> stop;
+	std::thread producer;
+};
+
+// fill in batches of at least 1/8 of the ring so the per-lambda setup is amortized
+static bool poisson_ring_produce(poisson_ring* r) {
+	uint64_t head=r->head.load(std::memory_order_relaxed);
+	uint64_t tail=r->tail.load(std::memory_order_acquire);
+	uint32_t space=r->capacity-(uint32_t)(head-tail);
+	if(space==0 || space<(r->capacity>>3)) {
+		return false;
+	}
+	uint32_t pos=(uint32_t)head&(r->capacity-1);
+	uint32_t first=r->capacity-pos;
+	if(first>space) {
+		first=space;
+	}
+	// two fills from the same seed give the same sequence as one
+	poisson_random_variate_integer_fill(&r->seed,r->lambda,r->data+pos,first);
+	poisson_random_variate_integer_fill(&r->seed,r->lambda,r->data,space-first);
+	r->head.store(head+space,std::memory_order_release);
+	return true;
+}
+
+static void poisson_buffer_producer(poisson_random_variate_buffer* b) {
+	while(!b->stop.load(std::memory_order_relaxed)) {
+		bool busy=false;
+		for(uint32_t i=0;i<b->ring_count;i++) {
+			busy|=poisson_ring_produce(&b->rings[i]);
+		}
+		if(!busy) {
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+}
+
+poisson_random_variate_buffer* poisson_random_variate_buffer_create(uint64_t seed, const int64_t* lambdas, uint32_t lambda_count, uint32_t capacity) {
+	if(capacity>MAX_CAPACITY) {
+		return NULL;
+	}
+	uint32_t cap=8;
+	while(cap<capacity) {
+		cap<<=1;
+	}
+	poisson_random_variate_buffer* b=new poisson_random_variate_buffer;
+	b->rings=new poisson_ring[lambda_count];
+	b->ring_count=lambda_count;
+	for(uint32_t i=0;i<lambda_count;i++) {
+		poisson_ring* r=&b->rings[i];
+		r->head.store(0,std::memory_order_relaxed);
+		r->seed=poisson_random_variate_derive_seed(seed,i);
+		r->lambda=lambdas[i];
+		r->tail.store(0,std::memory_order_relaxed);
+		r->low_water.store(cap,std::memory_order_relaxed);
+		r->underruns.store(0,std::memory_order_relaxed);
+		r->data=new uint32_t[cap];
+		r->capacity=cap;
+		// prime the ring so the first pops don't have to wait for the thread to start
+		poisson_ring_produce(r);
+	}
+	b->stop.store(false,std::memory_order_relaxed);
+	b->producer=std::thread(poisson_buffer_producer,b);
+	return b;
+}
+
+void poisson_random_variate_buffer_destroy(poisson_random_variate_buffer* b) {
+	b->stop.store(true,std::memory_order_relaxed);
+	b->producer.join();
+	for(uint32_t i=0;i<b->ring_count;i++) {
+		delete[] b->rings[i].data;
+	}
+	delete[] b->rings;
+	delete b;
+}
+
+static inline uint32_t poisson_ring_take(poisson_ring* r, uint64_t head, uint64_t tail) {
+	uint32_t fill=(uint32_t)(head-tail);
+	if(fill<r->low_water.load(std::memory_order_relaxed)) {
+		r->low_water.store(fill,std::memory_order_relaxed);
+	}
+	uint32_t ret=r->data[(uint32_t)tail&(r->capacity-1)];
+	r->tail.store(tail+1,std::memory_order_release);
+	return ret;
+}
+
+uint32_t poisson_random_variate_buffer_pop(poisson_random_variate_buffer* b, uint32_t index) {
+	poisson_ring* r=&b->rings[index];
+	uint64_t tail=r->tail.load(std::memory_order_relaxed);
+	uint64_t head=r->head.load(std::memory_order_acquire);
+	if(head==tail) {
+		r->underruns.store(r->underruns.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+		do {
+			std::this_thread::yield();
+			head=r->head.load(std::memory_order_acquire);
+		} while(head==tail);
+	}
+	return poisson_ring_take(r,head,tail);
+}
+
+int poisson_random_variate_buffer_try_pop(poisson_random_variate_buffer* b, uint32_t index, uint32_t* out) {
+	poisson_ring* r=&b->rings[index];
+	uint64_t tail=r->tail.load(std::memory_order_relaxed);
+	uint64_t head=r->head.load(std::memory_order_acquire);
+	if(head==tail) {
+		return 0;
+	}
+	*out=poisson_ring_take(r,head,tail);
+	return 1;
+}
+
+void poisson_random_variate_buffer_get_stats(const poisson_random_variate_buffer* b, uint32_t index, poisson_random_variate_buffer_stats* stats) {
+	const poisson_ring* r=&b->rings[index];
+	uint64_t tail=r->tail.load(std::memory_order_acquire);
+	uint64_t head=r->head.load(std::memory_order_acquire);
+	stats->capacity=r->capacity;
+	stats->fill=(uint32_t)(head-tail);
+	stats->low_water=r->low_water.load(std::memory_order_relaxed);
+	stats->produced=head;
+	stats->consumed=tail;
+	stats->underruns=r->underruns.load(std::memory_order_relaxed);
+}
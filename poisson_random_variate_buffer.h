@@ -0,0 +1,66 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef POISSON_RANDOM_VARIATE_BUFFER_H
+#define POISSON_RANDOM_VARIATE_BUFFER_H
+
+#include <stdint.h>
+
+// Background pre-generation of poisson_random_variate_integer variates for a fixed set of lambdas.
+// A producer thread fills one lock-free single producer/single consumer ring per lambda, and the
+// consumer pops from them. Ring i is the stream poisson_random_variate_derive_seed(seed,i), so the
+// values popped only depend on the seed, never on thread timing.
+// All pops must come from a single consumer thread.
+
+typedef struct poisson_random_variate_buffer poisson_random_variate_buffer;
+
+typedef struct poisson_random_variate_buffer_stats {
+	uint32_t capacity;
+	uint32_t fill;      // variates currently ready
+	uint32_t low_water; // lowest fill seen by a pop
+	uint64_t produced;
+	uint64_t consumed;
+	uint64_t underruns; // pops that found the ring empty and had to wait
+} poisson_random_variate_buffer_stats;
+
+// lambdas are fixed 32.32, capacity is per ring and is rounded up to a power of 2
+// returns NULL if capacity is above 2^31
+poisson_random_variate_buffer* poisson_random_variate_buffer_create(uint64_t seed, const int64_t* lambdas, uint32_t lambda_count, uint32_t capacity);
+
+void poisson_random_variate_buffer_destroy(poisson_random_variate_buffer* buffer);
+
+// waits for the producer if ring index is empty
+uint32_t poisson_random_variate_buffer_pop(poisson_random_variate_buffer* buffer, uint32_t index);
+
+// returns 0 and leaves *out alone if ring index is empty
+int poisson_random_variate_buffer_try_pop(poisson_random_variate_buffer* buffer, uint32_t index, uint32_t* out);
+
+void poisson_random_variate_buffer_get_stats(const poisson_random_variate_buffer* buffer, uint32_t index, poisson_random_variate_buffer_stats* stats);
+
+#endif // POISSON_RANDOM_VARIATE_BUFFER_H
@@ -0,0 +1,185 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "poisson_random_variate_field.h"
+#include "poisson_random_variate_integer.h"
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const uint64_t LAMBDA_BLOCK=4096;
+
+static uint64_t poisson_field_fill(uint64_t* seed, int64_t lambda, uint8_t* out, uint64_t count) {
+	return poisson_random_variate_integer_fill_u8(seed,lambda,out,count);
+}
+
+static uint64_t poisson_field_fill(uint64_t* seed, int64_t lambda, uint16_t* out, uint64_t count) {
+	return poisson_random_variate_integer_fill_u16(seed,lambda,out,count);
+}
+
+static uint64_t poisson_field_fill(uint64_t* seed, int64_t lambda, uint32_t* out, uint64_t count) {
+	poisson_random_variate_integer_fill(seed,lambda,out,count);
+	return 0;
+}
+
+// a fill of one cell is the same as a single call, so per cell lambdas give the same values as a constant one would
+template<typename T> static uint64_t poisson_field_cells(const poisson_random_variate_field* field, uint64_t first, uint64_t count, uint64_t* seed, T* out) {
+	if(!field->lambda_fn) {
+		return poisson_field_fill(seed,field->lambda,out,count);
+	}
+	int64_t lambdas[LAMBDA_BLOCK];
+	uint64_t saturated=0;
+	for(uint64_t i=0;i<count;i+=LAMBDA_BLOCK) {
+		uint64_t n=(count-i<LAMBDA_BLOCK)?count-i:LAMBDA_BLOCK;
+		field->lambda_fn(field->context,first+i,n,lambdas);
+		for(uint64_t j=0;j<n;j++) {
+			saturated+=poisson_field_fill(seed,lambdas[j],out+i+j,1);
+		}
+	}
+	return saturated;
+}
+
+static bool poisson_field_valid(const poisson_random_variate_field* field) {
+	return field->chunk_size>0 && (field->width==1 || field->width==2 || field->width==4);
+}
+
+uint64_t poisson_random_variate_field_chunk(const poisson_random_variate_field* field, uint64_t chunk, void* out) {
+	if(!poisson_field_valid(field)) {
+		return 0;
+	}
+	uint64_t first=chunk*field->chunk_size;
+	if(first>=field->count) {
+		return 0;
+	}
+	uint64_t count=field->count-first;
+	if(count>field->chunk_size) {
+		count=field->chunk_size;
+	}
+	uint64_t seed=poisson_random_variate_derive_seed(field->seed,chunk);
+	switch(field->width) {
+		case 1: return poisson_field_cells(field,first,count,&seed,(uint8_t*)out);
+		case 2: return poisson_field_cells(field,first,count,&seed,(uint16_t*)out);
+		default: return poisson_field_cells(field,first,count,&seed,(uint32_t*)out);
+	}
+}
+
+// generates every chunk into base. Dirty pages of a shared mapping are written back by the OS in the background,
+// so there is nothing to do here to overlap the writes with generation.
+static uint64_t poisson_field_generate(const poisson_random_variate_field* field, uint8_t* base) {
+	uint64_t chunk_bytes=field->chunk_size*field->width;
+	uint64_t chunks=(field->count+field->chunk_size-1)/field->chunk_size;
+	uint64_t total=0;
+	for(uint64_t c=0;c<chunks;c++) {
+		total+=poisson_random_variate_field_chunk(field,c,base+c*chunk_bytes);
+	}
+	return total;
+}
+
+#ifdef _WIN32
+
+int poisson_random_variate_field_file(const poisson_random_variate_field* field, const char* path, uint64_t* saturated) {
+	if(!poisson_field_valid(field)) {
+		return -1;
+	}
+	uint64_t bytes=field->count*field->width;
+	HANDLE file=CreateFileA(path,GENERIC_READ|GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(file==INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+	if(bytes==0) {
+		// a zero length file can't be mapped
+		CloseHandle(file);
+		if(saturated) {
+			*saturated=0;
+		}
+		return 0;
+	}
+	HANDLE mapping=CreateFileMappingA(file,NULL,PAGE_READWRITE,(DWORD)(bytes>>32),(DWORD)bytes,NULL);
+	if(!mapping) {
+		CloseHandle(file);
+		return -1;
+	}
+	uint8_t* base=(uint8_t*)MapViewOfFile(mapping,FILE_MAP_WRITE,0,0,0);
+	if(!base) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return -1;
+	}
+	uint64_t total=poisson_field_generate(field,base);
+	UnmapViewOfFile(base);
+	CloseHandle(mapping);
+	CloseHandle(file);
+	if(saturated) {
+		*saturated=total;
+	}
+	return 0;
+}
+
+#else
+
+int poisson_random_variate_field_file(const poisson_random_variate_field* field, const char* path, uint64_t* saturated) {
+	if(!poisson_field_valid(field)) {
+		return -1;
+	}
+	uint64_t bytes=field->count*field->width;
+	int fd=open(path,O_RDWR|O_CREAT|O_TRUNC,0644);
+	if(fd<0) {
+		return -1;
+	}
+	if(ftruncate(fd,bytes)!=0) {
+		close(fd);
+		return -1;
+	}
+	if(bytes==0) {
+		close(fd);
+		if(saturated) {
+			*saturated=0;
+		}
+		return 0;
+	}
+	uint8_t* base=(uint8_t*)mmap(NULL,bytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if(base==MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	uint64_t total=poisson_field_generate(field,base);
+	munmap(base,bytes);
+	close(fd);
+	if(saturated) {
+		*saturated=total;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,60 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef POISSON_RANDOM_VARIATE_FIELD_H
+#define POISSON_RANDOM_VARIATE_FIELD_H
+
+#include <stdint.h>
+
+// Generation of count fields that are larger than memory, chunk by chunk, into a memory mapped file.
+// Chunk i uses the seed poisson_random_variate_derive_seed(seed,i), so any chunk can be regenerated on its own.
+
+// fills lambdas[0..count) with the fixed 32.32 lambdas of cells first..first+count-1
+typedef void (*poisson_random_variate_field_lambda_fn)(void* context, uint64_t first, uint64_t count, int64_t* lambdas);
+
+typedef struct poisson_random_variate_field {
+	uint64_t seed;
+	int64_t lambda;                                   // fixed 32.32, used for every cell if lambda_fn is NULL
+	poisson_random_variate_field_lambda_fn lambda_fn; // optional per cell lambdas
+	void* context;                                    // passed to lambda_fn
+	uint64_t count;                                   // number of cells
+	uint64_t chunk_size;                              // cells per chunk
+	uint32_t width;                                   // bytes per count: 1, 2 or 4, narrower counts are saturated
+} poisson_random_variate_field;
+
+// generates chunk number chunk (the last one may be short) into out, returns the number of saturated counts
+// nothing is written if width is not 1, 2 or 4 or chunk_size is 0
+uint64_t poisson_random_variate_field_chunk(const poisson_random_variate_field* field, uint64_t chunk, void* out);
+
+// creates/truncates path and writes the whole field into it, in native byte order
+// returns 0 on success, -1 on failure (including a width other than 1, 2 or 4, or a chunk_size of 0). *saturated (if not NULL) is set to the number of saturated counts
+// the OS writes dirty pages back in the background, so call fsync or equivalent if the data must be on disk on return
+int poisson_random_variate_field_file(const poisson_random_variate_field* field, const char* path, uint64_t* saturated);
+
+#endif // POISSON_RANDOM_VARIATE_FIELD_H
@@ -27,8 +27,14 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "poisson_random_variate_integer.h"
 #include <cstdint>
+#include <cstddef>
+#include <cstdlib>
 #include <array>
+#include <chrono>
+#include <cstdio>
+#include <vector>
 #if __x86_64 || _M_X64
 #include <emmintrin.h>
 #include <smmintrin.h>
@@ -46,26 +52,281 @@ const uint64_t P_LN2_INV_2_POW_63=13306513097844322492ULL;
 #define clz64 (uint32_t)__lzcnt64
 #define clz32 (uint32_t)__lzcnt
 #define popcount __popcnt
+#if _M_X64
+#define prefetch(p) _mm_prefetch((const char*)(p),_MM_HINT_T0)
+#else
+#define prefetch(p) ((void)(p))
+#endif
 
 #elif defined(__GNUC__) || defined(__clang__) // gcc/clang
 
 #define clz64 __builtin_clzll
 #define clz32 __builtin_clz
 #define popcount __builtin_popcount
+#define prefetch(p) __builtin_prefetch(p)
 
 #endif
 
-constexpr std::array<int64_t,10> log_fact_table_fixed = {{
-	          0ULL,
-	          0ULL,
-	 2977044472ULL,
-	 7695548323ULL,
-	13649637266ULL,
-	20562120465ULL,
-	28257668788ULL,
-	36615289239ULL,
-	45546422654ULL,
-	54983430356ULL
+// ln(k!) in 32.32
+const int64_t LOG_FACT_TABLE_SIZE=256;
+
+constexpr std::array<int64_t,LOG_FACT_TABLE_SIZE> log_fact_table_fixed = {{
+	            0ULL,
+	            0ULL,
+	   2977044472ULL,
+	   7695548323ULL,
+	  13649637266ULL,
+	  20562120465ULL,
+	  28257668788ULL,
+	  36615289239ULL,
+	  45546422654ULL,
+	  54983430356ULL,
+	  64872958027ULL,
+	  75171839803ULL,
+	  85844432597ULL,
+	  96860806203ULL,
+	 108195471126ULL,
+	 119826458176ULL,
+	 131734636063ULL,
+	 143903194718ULL,
+	 156317246892ULL,
+	 168963516012ULL,
+	 181830088155ULL,
+	 194906212457ULL,
+	 208182138705ULL,
+	 221648983819ULL,
+	 235298621085ULL,
+	 249123587483ULL,
+	 263117005561ULL,
+	 277272517113ULL,
+	 291584226508ULL,
+	 306046651974ULL,
+	 320654683495ULL,
+	 335403546233ULL,
+	 350288768593ULL,
+	 365306154219ULL,
+	 380451757346ULL,
+	 395721860996ULL,
+	 411112957642ULL,
+	 426621731985ULL,
+	 442245045577ULL,
+	 457979923034ULL,
+	 473823539649ULL,
+	 489773210227ULL,
+	 505826379000ULL,
+	 521980610491ULL,
+	 538233581210ULL,
+	 554583072111ULL,
+	 571026961697ULL,
+	 587563219731ULL,
+	 604189901469ULL,
+	 620905142371ULL,
+	 637707153241ULL,
+	 654594215747ULL,
+	 671564678297ULL,
+	 688616952221ULL,
+	 705749508245ULL,
+	 722960873220ULL,
+	 740249627087ULL,
+	 757614400058ULL,
+	 775053869996ULL,
+	 792566759966ULL,
+	 810151835959ULL,
+	 827807904763ULL,
+	 845533811973ULL,
+	 863328440126ULL,
+	 881190706957ULL,
+	 899119563762ULL,
+	 917113993861ULL,
+	 935173011151ULL,
+	 953295658750ULL,
+	 971481007715ULL,
+	 989728155837ULL,
+	1008036226502ULL,
+	1026404367619ULL,
+	1044831750603ULL,
+	1063317569419ULL,
+	1081861039667ULL,
+	1100461397731ULL,
+	1119117899958ULL,
+	1137829821887ULL,
+	1156596457515ULL,
+	1175417118601ULL,
+	1194291134004ULL,
+	1213217849054ULL,
+	1232196624951ULL,
+	1251226838196ULL,
+	1270307880051ULL,
+	1289439156013ULL,
+	1308620085330ULL,
+	1327850100521ULL,
+	1347128646933ULL,
+	1366455182305ULL,
+	1385829176362ULL,
+	1405250110420ULL,
+	1424717477009ULL,
+	1444230779515ULL,
+	1463789531834ULL,
+	1483393258044ULL,
+	1503041492086ULL,
+	1522733777460ULL,
+	1542469666937ULL,
+	1562248722279ULL,
+	1582070513966ULL,
+	1601934620943ULL,
+	1621840630374ULL,
+	1641788137395ULL,
+	1661776744896ULL,
+	1681806063292ULL,
+	1701875710316ULL,
+	1721985310812ULL,
+	1742134496541ULL,
+	1762322905987ULL,
+	1782550184181ULL,
+	1802815982520ULL,
+	1823119958597ULL,
+	1843461776040ULL,
+	1863841104353ULL,
+	1884257618762ULL,
+	1904711000070ULL,
+	1925200934512ULL,
+	1945727113618ULL,
+	1966289234083ULL,
+	1986886997635ULL,
+	2007520110911ULL,
+	2028188285340ULL,
+	2048891237022ULL,
+	2069628686618ULL,
+	2090400359243ULL,
+	2111205984355ULL,
+	2132045295658ULL,
+	2152918030999ULL,
+	2173823932276ULL,
+	2194762745341ULL,
+	2215734219911ULL,
+	2236738109483ULL,
+	2257774171245ULL,
+	2278842165996ULL,
+	2299941858067ULL,
+	2321073015240ULL,
+	2342235408677ULL,
+	2363428812843ULL,
+	2384653005436ULL,
+	2405907767321ULL,
+	2427192882458ULL,
+	2448508137840ULL,
+	2469853323429ULL,
+	2491228232094ULL,
+	2512632659550ULL,
+	2534066404303ULL,
+	2555529267590ULL,
+	2577021053325ULL,
+	2598541568046ULL,
+	2620090620860ULL,
+	2641668023396ULL,
+	2663273589753ULL,
+	2684907136452ULL,
+	2706568482389ULL,
+	2728257448789ULL,
+	2749973859164ULL,
+	2771717539263ULL,
+	2793488317039ULL,
+	2815286022597ULL,
+	2837110488162ULL,
+	2858961548037ULL,
+	2880839038563ULL,
+	2902742798085ULL,
+	2924672666910ULL,
+	2946628487279ULL,
+	2968610103324ULL,
+	2990617361042ULL,
+	3012650108254ULL,
+	3034708194580ULL,
+	3056791471402ULL,
+	3078899791837ULL,
+	3101033010702ULL,
+	3123190984490ULL,
+	3145373571339ULL,
+	3167580631002ULL,
+	3189812024823ULL,
+	3212067615706ULL,
+	3234347268094ULL,
+	3256650847938ULL,
+	3278978222676ULL,
+	3301329261205ULL,
+	3323703833860ULL,
+	3346101812390ULL,
+	3368523069932ULL,
+	3390967480993ULL,
+	3413434921424ULL,
+	3435925268402ULL,
+	3458438400406ULL,
+	3480974197197ULL,
+	3503532539800ULL,
+	3526113310482ULL,
+	3548716392732ULL,
+	3571341671245ULL,
+	3593989031901ULL,
+	3616658361747ULL,
+	3639349548980ULL,
+	3662062482929ULL,
+	3684797054039ULL,
+	3707553153852ULL,
+	3730330674993ULL,
+	3753129511152ULL,
+	3775949557069ULL,
+	3798790708519ULL,
+	3821652862295ULL,
+	3844535916197ULL,
+	3867439769013ULL,
+	3890364320507ULL,
+	3913309471403ULL,
+	3936275123376ULL,
+	3959261179032ULL,
+	3982267541900ULL,
+	4005294116416ULL,
+	4028340807912ULL,
+	4051407522601ULL,
+	4074494167569ULL,
+	4097600650758ULL,
+	4120726880958ULL,
+	4143872767794ULL,
+	4167038221712ULL,
+	4190223153974ULL,
+	4213427476640ULL,
+	4236651102562ULL,
+	4259893945372ULL,
+	4283155919471ULL,
+	4306436940020ULL,
+	4329736922928ULL,
+	4353055784843ULL,
+	4376393443144ULL,
+	4399749815928ULL,
+	4423124822006ULL,
+	4446518380888ULL,
+	4469930412775ULL,
+	4493360838554ULL,
+	4516809579787ULL,
+	4540276558701ULL,
+	4563761698180ULL,
+	4587264921758ULL,
+	4610786153611ULL,
+	4634325318548ULL,
+	4657882342003ULL,
+	4681457150026ULL,
+	4705049669280ULL,
+	4728659827029ULL,
+	4752287551130ULL,
+	4775932770030ULL,
+	4799595412757ULL,
+	4823275408911ULL,
+	4846972688658ULL,
+	4870687182726ULL,
+	4894418822396ULL,
+	4918167539492ULL,
+	4941933266382ULL,
+	4965715935966ULL,
+	4989515481671ULL
 }};
 
 #ifdef _MSC_VER // Windows
@@ -98,6 +359,12 @@ static inline int64_t fixed_mult64u(uint64_t x, uint64_t y) {
 	return (uint64_t)__shiftleft128(rlo, rhi, 32);
 }
 
+// quotient must fit in 64 bits, ie. hi<d
+static inline uint64_t divu128by64(uint64_t hi, uint64_t lo, uint64_t d) {
+	uint64_t r;
+	return _udiv128(hi, lo, d, &r);
+}
+
 #elif defined(__GNUC__) || defined(__clang__) // gcc/clang
 
 static inline uint64_t multu64hi(uint64_t x,uint64_t y) {
@@ -122,6 +389,11 @@ static inline int64_t fixed_mult64u(uint64_t x,uint64_t y) {
 	return (uint64_t)((((unsigned __int128)x)*y)>>32);
 }
 
+// quotient must fit in 64 bits, ie. hi<d
+static inline uint64_t divu128by64(uint64_t hi,uint64_t lo,uint64_t d) {
+	return (uint64_t)(((((unsigned __int128)hi)<<64)|lo)/d);
+}
+
 #endif
 
 static inline uint32_t multu32hi(uint32_t x,uint32_t y) {
@@ -201,8 +473,10 @@ typedef __m128i uint16x8_t;
 typedef variant16 uint16x8_t;
 #endif
 
+const uint64_t RAND_INCREMENT=0x60bee2bee120fc15ULL;
+
 static inline uint64_t fast_rand64(uint64_t* seed) {
-	*seed += 0x60bee2bee120fc15ULL;
+	*seed += RAND_INCREMENT;
 	uint64_t hi,lo;
 	multu64hilo(*seed,0xa3b195354a39b70dULL,&hi,&lo);
 	uint64_t m1 = hi^lo;
@@ -237,45 +511,152 @@ static inline uint64_t horizonal_mult8_16_corr(uint16x8_t x) {
 	return multu64hi(startx0,startx1);
 }
 
-uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda) {
-	if(lambda<=0) {
-		return 0;
+struct poisson_params {
+	int64_t lambda;
+	// lambda<=38: lambda/ln(2) as whole binary digits plus 2^(fractional digits)
+	int32_t int_digits;
+	uint32_t exp2_frac;
+	// lambda>38: PTRD constants, all 32.32
+	uint64_t iu;
+	uint64_t ismu;
+	uint64_t ib;
+	uint64_t ia;
+	uint64_t ivr;
+	uint64_t iinv_alpha;
+	int64_t squeeze_limit; // k below which the table squeeze can be used
+	int64_t ln_u;
+};
+
+// everything that only depends on lambda, so that it can be hoisted out of batch loops
+static inline void poisson_setup_digits(poisson_params* p, int64_t lambda) {
+	uint64_t num_digits=multu64hi(lambda,P_LN2_INV_2_POW_63)<<1;
+	p->int_digits=num_digits>>32;
+	p->exp2_frac=p_exp2_32_internal(num_digits&0xFFFFFFFF); // e^(ln(2)*x) = (e^ln(2))^x = 2^x
+}
+
+static inline void poisson_setup_ptrd(poisson_params* p, int64_t lambda) {
+	uint64_t iu=lambda;
+	p->iu=iu;
+	//double smu=std::sqrt(u); // >=3.1623 <=10000
+	p->ismu=fixed_sqrt_32_32(iu);
+	//double b=0.931+2.53*smu; // >=8.9316 <=25300
+	p->ib=3998614553ULL+(multu64hi(p->ismu,11667565626621291397ULL)<<2);
+	//double a=-0.059+0.02483*b; // >=0.16277 <=629
+	p->ia=multu64hi(p->ib,458032655350208166ULL)-253403070ULL;
+	//double vr=0.9277-3.6224/(b-2.0); // >=0.4051, <=0.9277
+	p->ivr=3984441160ULL-((16705371433151369943ULL/(p->ib-8589934592ULL))<<2);
+	//double inv_alpha=1.1239+1.1328/(b-3.4); // >=1.1239, <1.3287
+	p->iinv_alpha=4827113744ULL+((10448235843349090035ULL/(p->ib-14602888806ULL))<<1);
+	if(iu<((uint64_t)LOG_FACT_TABLE_SIZE<<32)) {
+		p->squeeze_limit=LOG_FACT_TABLE_SIZE;
+		p->ln_u=log_64_fixed(iu);
+	} else {
+		p->squeeze_limit=0;
 	}
-	if(lambda<=77309411328LL) { // 18
-		uint64_t num_digits=multu64hi(lambda,P_LN2_INV_2_POW_63)<<1;
-		int32_t int_digits=num_digits>>32;
-		uint64_t start=((uint64_t)p_exp2_32_internal(num_digits&0xFFFFFFFF))<<33;
-		uint32_t ret=-1;
-		while(int_digits>=0) {
-			uint64_t x=(fast_rand64(seed)|1);
-			start=multu64hi(start,x);
-			uint32_t z=clz64(start);
-			int_digits-=z;
-			start<<=z;
-			ret++;
-		}
-		return ret;
+}
+
+static inline void poisson_setup(poisson_params* p, int64_t lambda) {
+	p->lambda=lambda;
+	if(lambda<=0) {
+		return;
 	}
 	if(lambda<=163208757248LL) { // 38
-		uint64_t num_digits=multu64hi(lambda,P_LN2_INV_2_POW_63)<<1;
-		int32_t int_digits=num_digits>>32;
-		num_digits&=0xFFFFFFFFULL;
-		uint32_t r7=p_exp2_32_internal((uint32_t)num_digits)>>15; // e^(ln(2)*x) = (e^ln(2))^x = 2^x
-		int32_t ret=-1;
-		uint16_t old_start_flag=r7;
-		int32_t old_int_digits=int_digits;
+		poisson_setup_digits(p,lambda);
+		return;
+	}
+	poisson_setup_ptrd(p,lambda);
+}
+
+static inline uint32_t poisson_small(uint64_t* seed, int32_t int_digits, uint32_t exp2_frac) {
+	uint64_t start=((uint64_t)exp2_frac)<<33;
+	uint32_t ret=-1;
+	while(int_digits>=0) {
+		uint64_t x=(fast_rand64(seed)|1);
+		start=multu64hi(start,x);
+		uint32_t z=clz64(start);
+		int_digits-=z;
+		start<<=z;
+		ret++;
+	}
+	return ret;
+}
+
+static inline uint32_t poisson_mid(uint64_t* seed, int32_t int_digits, uint32_t exp2_frac) {
+	uint32_t r7=exp2_frac>>15;
+	int32_t ret=-1;
+	uint16_t old_start_flag=r7;
+	int32_t old_int_digits=int_digits;
+#if __x86_64 || _M_X64
+	__m128i zero=_mm_setzero_si128();
+	__m128i const_1=_mm_set1_epi16(1);
+	__m128i const_FF00=_mm_set1_epi16(0xFF00U);
+	__m128i const_F000=_mm_set1_epi16(0xF000U);
+	__m128i const_C000=_mm_set1_epi16(0xC000U);
+	__m128i const_8000=_mm_set1_epi16(0x8000U);
+	__m128i old_start=_mm_insert_epi16(_mm_set1_epi16(0xFFFFU),r7,0);
+	uint64_t a=fast_rand64(seed);
+	uint64_t b=fast_rand64(seed);
+	__m128i old_rand=_mm_set_epi64x(b,a);
+	__m128i startx=_mm_insert_epi16(old_rand,(((uint32_t)_mm_extract_epi16(old_rand,0))*r7)>>16,0);
+	startx=_mm_or_si128(startx,const_1);
+	__m128i clz_select8=_mm_cmpeq_epi16(_mm_and_si128(startx,const_FF00),zero);
+	startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,8),clz_select8);
+	__m128i clz_select4=_mm_cmpeq_epi16(_mm_and_si128(startx,const_F000),zero);
+	startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,4),clz_select4);
+	__m128i clz_select2=_mm_cmpeq_epi16(_mm_and_si128(startx,const_C000),zero);
+	startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,2),clz_select2);
+	__m128i clz_select1=_mm_cmpeq_epi16(_mm_and_si128(startx,const_8000),zero);
+	startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,1),clz_select1);
+	uint32_t t=popcount(_mm_movemask_epi8(clz_select8));
+	t=popcount(_mm_movemask_epi8(clz_select4))+t+t;
+	t=popcount(_mm_movemask_epi8(clz_select2))+t+t;
+	t=popcount(_mm_movemask_epi8(clz_select1))+t+t;
+	int_digits-=(t>>1);
+#elif __aarch64__
+	uint16x8_t const_1=vdupq_n_u16(1);
+	uint16x8_t old_start=vsetq_lane_u16(r7,vdupq_n_u16(0xFFFF),0);
+	uint64_t a=fast_rand64(seed);
+	uint64_t b=fast_rand64(seed);
+	uint16x8_t old_rand=vcombine_u16(vcreate_u16(a),vcreate_u16(b));
+	uint16x8_t startx=vsetq_lane_u16((((uint32_t)vgetq_lane_u16(old_rand,0))*r7)>>16,old_rand,0);
+	startx=vorrq_u16(startx,const_1);
+	uint16x8_t zz=vclzq_u16(startx);
+	startx=vshlq_u16(startx,vreinterpretq_s16_u16(zz));
+	int_digits-=vaddvq_u16(zz);
+#else // don't know what the processor is
+	variant16 startx,old_start,old_rand;
+	old_rand.s64[0]=(fast_rand64(seed));
+	old_rand.s64[1]=(fast_rand64(seed));
+	startx=old_rand;
+	startx.s16[0]=((((uint32_t)old_rand.s16[0])*r7)>>16)|1U;
+	for(uint32_t i=0;i<8;i++) {
+		old_start.s16[i]=0xFFFF;
+		uint16_t x=startx.s16[i]|(uint16_t)1;
+		int32_t z=clz32(x)-16;
+		int_digits-=z;
+		x<<=z;
+		startx.s16[i]=x;
+	}
+	old_start.s16[0]=r7;
+#endif
+	ret += 8;
+	uint16x8_t old_old_start=old_start;
+	uint16_t old_old_start_flag=old_start_flag;
+	int32_t old_old_int_digits=old_int_digits;
+	uint16x8_t old_old_rand=old_rand;
+	while (int_digits >= 0) {
+		old_old_start=old_start;
+		old_old_start_flag=old_start_flag;
+		old_old_int_digits=old_int_digits;
+		old_old_rand=old_rand;
+		old_start=startx;
+		old_start_flag=0;
+		old_int_digits=int_digits;
 #if __x86_64 || _M_X64
-		__m128i zero=_mm_setzero_si128();
-		__m128i const_1=_mm_set1_epi16(1);
-		__m128i const_FF00=_mm_set1_epi16(0xFF00U);
-		__m128i const_F000=_mm_set1_epi16(0xF000U);
-		__m128i const_C000=_mm_set1_epi16(0xC000U);
-		__m128i const_8000=_mm_set1_epi16(0x8000U);
-		__m128i old_start=_mm_insert_epi16(_mm_set1_epi16(0xFFFFU),r7,0);
 		uint64_t a=fast_rand64(seed);
 		uint64_t b=fast_rand64(seed);
-		__m128i old_rand=_mm_set_epi64x(b,a);
-		__m128i startx=_mm_insert_epi16(old_rand,(((uint32_t)_mm_extract_epi16(old_rand,0))*r7)>>16,0);
+		old_rand=_mm_set_epi64x(b,a);
+		startx=_mm_mulhi_epu16(startx,old_rand);
 		startx=_mm_or_si128(startx,const_1);
 		__m128i clz_select8=_mm_cmpeq_epi16(_mm_and_si128(startx,const_FF00),zero);
 		startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,8),clz_select8);
@@ -287,143 +668,261 @@ uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda) {
 		startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,1),clz_select1);
 		uint32_t t=popcount(_mm_movemask_epi8(clz_select8));
 		t=popcount(_mm_movemask_epi8(clz_select4))+t+t;
-		t=popcount(_mm_movemask_epi8(clz_select2))+t+t;
-		t=popcount(_mm_movemask_epi8(clz_select1))+t+t;
-		int_digits-=(t>>1);
+		t=(popcount(_mm_movemask_epi8(clz_select1))>>1)+popcount(_mm_movemask_epi8(clz_select2))+t+t;
+		int_digits-=t;
 #elif __aarch64__
-		uint16x8_t const_1=vdupq_n_u16(1);
-		uint16x8_t old_start=vsetq_lane_u16(r7,vdupq_n_u16(0xFFFF),0);
 		uint64_t a=fast_rand64(seed);
 		uint64_t b=fast_rand64(seed);
-		uint16x8_t old_rand=vcombine_u16(vcreate_u16(a),vcreate_u16(b));
-		uint16x8_t startx=vsetq_lane_u16((((uint32_t)vgetq_lane_u16(old_rand,0))*r7)>>16,old_rand,0);
-		startx=vorrq_u16(startx,const_1);
-		uint16x8_t zz=vclzq_u16(startx);
-		startx=vshlq_u16(startx,vreinterpretq_s16_u16(zz));
-		int_digits-=vaddvq_u16(zz);
+		old_rand=vcombine_u16(vcreate_u16(a),vcreate_u16(b));
+		uint32x4_t mul_lo=vmull_u16(vget_low_u16(startx),vget_low_u16(old_rand));
+		uint32x4_t mul_hi=vmull_high_u16(startx,old_rand);
+		startx=vcombine_u16(vshrn_n_u32(mul_lo,16),vshrn_n_u32(mul_hi,16));
+		uint16x8_t mult=vorrq_u16(startx,const_1);
+		uint16x8_t z=vclzq_u16(mult);
+		startx=vshlq_u16(mult,vreinterpretq_s16_u16(z));
+		int_digits-=vaddvq_u16(z);
 #else // don't know what the processor is
-		variant16 startx,old_start,old_rand;
+#warning noopt
 		old_rand.s64[0]=(fast_rand64(seed));
 		old_rand.s64[1]=(fast_rand64(seed));
-		startx=old_rand;
-		startx.s16[0]=((((uint32_t)old_rand.s16[0])*r7)>>16)|1U;
 		for(uint32_t i=0;i<8;i++) {
-			old_start.s16[i]=0xFFFF;
-			uint16_t x=startx.s16[i]|(uint16_t)1;
+			uint32_t x=startx.s16[i];
+			x=((x*old_rand.s16[i])>>16)|1U;
 			int32_t z=clz32(x)-16;
 			int_digits-=z;
 			x<<=z;
 			startx.s16[i]=x;
 		}
-		old_start.s16[0]=r7;
 #endif
-		ret += 8;
-		uint16x8_t old_old_start=old_start;
-		uint16_t old_old_start_flag=old_start_flag;
-		int32_t old_old_int_digits=old_int_digits;
-		uint16x8_t old_old_rand=old_rand;
-		while (int_digits >= 0) {
-			old_old_start=old_start;
-			old_old_start_flag=old_start_flag;
-			old_old_int_digits=old_int_digits;
-			old_old_rand=old_rand;
-			old_start=startx;
-			old_start_flag=0;
-			old_int_digits=int_digits;
-#if __x86_64 || _M_X64
-			uint64_t a=fast_rand64(seed);
-			uint64_t b=fast_rand64(seed);
-			old_rand=_mm_set_epi64x(b,a);
-			startx=_mm_mulhi_epu16(startx,old_rand);
-			startx=_mm_or_si128(startx,const_1);
-			__m128i clz_select8=_mm_cmpeq_epi16(_mm_and_si128(startx,const_FF00),zero);
-			startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,8),clz_select8);
-			__m128i clz_select4=_mm_cmpeq_epi16(_mm_and_si128(startx,const_F000),zero);
-			startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,4),clz_select4);
-			__m128i clz_select2=_mm_cmpeq_epi16(_mm_and_si128(startx,const_C000),zero);
-			startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,2),clz_select2);
-			__m128i clz_select1=_mm_cmpeq_epi16(_mm_and_si128(startx,const_8000),zero);
-			startx=_mm_blendv_epi8(startx,_mm_slli_epi16(startx,1),clz_select1);
-			uint32_t t=popcount(_mm_movemask_epi8(clz_select8));
-			t=popcount(_mm_movemask_epi8(clz_select4))+t+t;
-			t=(popcount(_mm_movemask_epi8(clz_select1))>>1)+popcount(_mm_movemask_epi8(clz_select2))+t+t;
-			int_digits-=t;
-#elif __aarch64__
-			uint64_t a=fast_rand64(seed);
-			uint64_t b=fast_rand64(seed);
-			old_rand=vcombine_u16(vcreate_u16(a),vcreate_u16(b));
-			uint32x4_t mul_lo=vmull_u16(vget_low_u16(startx),vget_low_u16(old_rand));
-			uint32x4_t mul_hi=vmull_high_u16(startx,old_rand);
-			startx=vcombine_u16(vshrn_n_u32(mul_lo,16),vshrn_n_u32(mul_hi,16));
-			uint16x8_t mult=vorrq_u16(startx,const_1);
-			uint16x8_t z=vclzq_u16(mult);
-			startx=vshlq_u16(mult,vreinterpretq_s16_u16(z));
-			int_digits-=vaddvq_u16(z);
-#else // don't know what the processor is
-#warning noopt
-			old_rand.s64[0]=(fast_rand64(seed));
-			old_rand.s64[1]=(fast_rand64(seed));
-			for(uint32_t i=0;i<8;i++) {
-				uint32_t x=startx.s16[i];
-				x=((x*old_rand.s16[i])>>16)|1U;
-				int32_t z=clz32(x)-16;
-				int_digits-=z;
-				x<<=z;
-				startx.s16[i]=x;
-			}
-#endif
-			ret+=8;
-		}
-		union variant16 urand;
+		ret+=8;
+	}
+	union variant16 urand;
+	ret-=8;
+	uint64_t start64=horizonal_mult8_16_corr(old_start);
+	int32_t z=clz64(start64);
+	if(old_start_flag==0 && old_int_digits<z) {
 		ret-=8;
-		uint64_t start64=horizonal_mult8_16_corr(old_start);
-		int32_t z=clz64(start64);
-		if(old_start_flag==0 && old_int_digits<z) {
-			ret-=8;
-			int_digits=old_old_int_digits;
+		int_digits=old_old_int_digits;
 #if __x86_64 || _M_X64 || __aarch64__
-			urand.v=old_old_rand;
+		urand.v=old_old_rand;
 #else
-			urand=old_old_rand;
+		urand=old_old_rand;
 #endif
-			old_start_flag=old_old_start_flag;
-			start64=horizonal_mult8_16_corr(old_old_start);
-			z=clz64(start64);
-		} else {
-			int_digits=old_int_digits;
+		old_start_flag=old_old_start_flag;
+		start64=horizonal_mult8_16_corr(old_old_start);
+		z=clz64(start64);
+	} else {
+		int_digits=old_int_digits;
 #if __x86_64 || _M_X64 || __aarch64__
-			urand.v=old_rand;
+		urand.v=old_rand;
 #else
-			urand=old_rand;
+		urand=old_rand;
 #endif
+	}
+	uint16_t start;
+	if(old_start_flag==0) {
+		int_digits-=z;
+		start=(uint16_t)(start64>>(48-z));
+	} else {
+		start=old_start_flag;
+	}
+	uint32_t i=0;
+	while(int_digits>=0 && i<8) {
+		start=((((uint32_t)start)*urand.s16[i++])>>16)|1U;
+		int32_t z=clz32(start)-16;
+		int_digits-=z;
+		start<<=z;
+		ret++;
+	}
+	return ret;
+}
+
+// the two sides of the k>=10 test differ by at most about 2^17 (in 32.32) between the Stirling form and
+// the table form, plus 2^8 for log_64_fixed, so this leaves a wide safety factor
+const int64_t SQUEEZE_MARGIN=1<<20;
+
+// one PTRD trial, returns false if it was rejected, otherwise sets *k
+static inline bool poisson_ptrd_trial(uint64_t* seed, const poisson_params* p, uint32_t* k) {
+	uint64_t iu=p->iu;
+	uint64_t ismu=p->ismu;
+	uint64_t ib=p->ib;
+	uint64_t ia=p->ia;
+	uint64_t ivr=p->ivr;
+	uint64_t iinv_alpha=p->iinv_alpha;
+	uint64_t iV=fast_rand64(seed)>>32;
+	//if(V<0.86*vr) { // V/vr<0.86
+	if(iV<multu64hi(15864199903390214389ULL,ivr)) {
+		//double U=V/vr-0.43; // >=-0.43, <=0.43
+		int64_t iU=(iV<<32)/ivr-1846835937ULL;
+		//double us=0.5-abs(U); // >=0.07, <=0.5
+		uint64_t ius=2147483648ULL-abs(iU);
+		//uint64_t k=std::floor((2.0*a/us+b)*U+u+0.445);
+		uint64_t i2a_div_us=((ia<<21)/ius)<<12; //udiv64fixed(ia<<1,ius);
+		uint64_t ik=(fixed_mult64s(i2a_div_us+ib,iU)+iu+1911260447ULL)>>32;
+		*k=(uint32_t)ik;
+		return true;
+	}
+	uint64_t it=fast_rand64(seed)>>32;
+	//double t=it/4294967296.0;
+	int64_t iU;
+	if(iV>=ivr) {
+		//U=t-0.5; // >=-0.5, <=0.5
+		iU=it-2147483648ULL;
+	} else {
+		//U=V/vr-0.93; // >=-0.93, <=0.07
+		iU=(iV<<32)/ivr-3994319585ULL;
+		//U=((U<0)?-0.5:0.5)-U; // >=-0.5, <=0.5
+		iU=((iU<0)?-2147483648LL:2147483648LL)-iU;
+		//V=t*vr; // >=0, <=0.9277
+		iV=fixed_mult64u(it,ivr);
+	}
+	//double us=0.5-abs(U); // >=0, <=0.5
+	uint64_t ius=2147483648ULL-abs(iU);
+	if(ius<65536 || (ius<55834575ULL && iV>ius)) {
+		return false;
+	}
+	//double k=std::floor((2.0*a/us+b)*U+u+0.445); // anything
+	uint64_t i2a_div_us=((ia<<21)/ius)<<12; //udiv64fixed(ia<<1,ius);
+	int64_t ik=(fixed_mult64s(i2a_div_us+ib,iU)+(int64_t)iu+1911260447LL)>>32;
+	//V=V*inv_alpha/(a/(us*us)+b);
+	iV=((fixed_mult64u(iinv_alpha,iV)<<31)/((((ia<<20)/fixed_mult64u(ius,ius))<<12)+ib)<<1);
+	if(ik>=10.0) {
+		uint64_t y=fixed_mult64u(iV,ismu);
+		if(ik<p->squeeze_limit && y!=0) {
+			// The test below is ln(y)<=(k+0.5)ln(u/k)-u-ln(sqrt(2pi))+k-stirling(k), which is ln(y)<=k ln(u)-u-ln(k!)+ln(u)/2
+			// to within SQUEEZE_MARGIN. Use the table for ln(k!) and bound ln(y) using only its leading zeros,
+			// and only fall through to the full test when that can't decide. The results are unchanged.
+			// This needs k<256 for the table, so it is only set up for lambda<256 (squeeze_limit), and larger
+			// lambdas always use the full test.
+			int64_t rhs=ik*p->ln_u-(int64_t)iu-log_fact_table_fixed[ik]+(p->ln_u>>1);
+			uint32_t lead=clz64(y);
+			int64_t ln_pow2=(31-(int64_t)lead)*2977044472LL;
+			uint64_t frac=((y<<lead)<<1)>>32;
+			if(ln_pow2+(int64_t)frac<=rhs-SQUEEZE_MARGIN) { // ln(2^e*(1+f))<=ln(2)*e+f
+				*k=(uint32_t)ik;
+				return true;
+			}
+			if(ln_pow2+(int64_t)((frac*2977044472ULL)>>32)>rhs+SQUEEZE_MARGIN) { // ln(2^e*(1+f))>=ln(2)*(e+f)
+				return false;
+			}
+			int64_t lhs=log_64_fixed(y);
+			if(lhs<=rhs-SQUEEZE_MARGIN) {
+				*k=(uint32_t)ik;
+				return true;
+			}
+			if(lhs>rhs+SQUEEZE_MARGIN) {
+				return false;
+			}
 		}
-		uint16_t start;
-		if(old_start_flag==0) {
-			int_digits-=z;
-			start=(uint16_t)(start64>>(48-z));
-		} else {
-			start=old_start_flag;
+		// y rounds to 0 when us is tiny and k is far out, and ln(0) isn't defined, so use ln(2^-32) there,
+		// which rejects all of them except ones of vanishing probability
+		int64_t lhs=log_64_fixed(y|1);
+		int64_t rhs=((ik<<1)+1)*((log_64_fixed(iu/ik))>>1)-iu-3946810947LL+(ik<<32);
+		if(lhs>rhs) {
+			return false;
 		}
-		uint32_t i=0;
-		while(int_digits>=0 && i<8) {
-			start=((((uint32_t)start)*urand.s16[i++])>>16)|1U;
-			int32_t z=clz32(start)-16;
-			int_digits-=z;
-			start<<=z;
-			ret++;
+		rhs-=(357913941ULL-(4294967296ULL/(360*ik*ik)))/ik;
+		if(lhs>rhs) {
+			return false;
 		}
-		return ret;
+		*k=(uint32_t)ik;
+		return true;
+	} else if(0<=ik && log_64_fixed(iV|1)<((int64_t)ik)*log_64_fixed(iu)-(int64_t)iu-log_fact_table_fixed[ik]) {
+		*k=(uint32_t)ik;
+		return true;
 	}
-	uint64_t iu=lambda;
+	return false;
+}
+
+static inline uint32_t poisson_ptrd(uint64_t* seed, const poisson_params* p) {
+	uint32_t k;
+	while(!poisson_ptrd_trial(seed,p,&k)) {
+	}
+	return k;
+}
+
+static inline uint32_t poisson_sample(uint64_t* seed, const poisson_params* p) {
+	if(p->lambda<=0) {
+		return 0;
+	}
+	if(p->lambda<=77309411328LL) { // 18
+		return poisson_small(seed,p->int_digits,p->exp2_frac);
+	}
+	if(p->lambda<=163208757248LL) { // 38
+		return poisson_mid(seed,p->int_digits,p->exp2_frac);
+	}
+	return poisson_ptrd(seed,p);
+}
+
+uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda) {
+	poisson_params p;
+	poisson_setup(&p,lambda);
+	return poisson_sample(seed,&p);
+}
+
+// Huge lambda: PTRD with lambda as 64.64 in the range [2^10,2^48). Above about 10^3 the 32.32 version starts to lose
+// accuracy ((k+0.5)ln(u/k) and k-u are large and cancel, which biases the mean more as lambda grows), and
+// above 2^31 lambda doesn't fit at all. From 2^10 up, 16 standard deviations is at most u/2, so |d/u|<=1/2 in
+// the series below and k>0 in the Stirling correction.
+// The parameters are the same as poisson_ptrd, but the acceptance test is written in terms of d=k-u and x=d/u:
+//	(k+0.5)ln(u/k)+k-u = -u*h(x)-log1p(x)/2 where h(x)=(1+x)log1p(x)-x = sum (-1)^n x^n/(n(n-1)), n>=2
+// which has no cancellation, so 32.32 is enough even though k and u are large.
+
+const uint64_t HUGE_LAMBDA_MIN=1ULL<<10;
+const uint64_t HUGE_LAMBDA_LIMIT=1ULL<<48;
+
+// floor(sqrt(hi*2^64+lo)), for hi<2^48
+static inline uint64_t isqrt128(uint64_t hi, uint64_t lo) {
+	// fixed_sqrt_32_32 gets about 30 bits, then Newton-Raphson doubles that each time
+	uint64_t x=fixed_sqrt_32_32(hi)<<16;
+	x=(x+divu128by64(hi,lo,x))>>1;
+	x=(x+divu128by64(hi,lo,x))>>1;
+	uint64_t rhi,rlo;
+	while(true) {
+		multu64hilo(x,x,&rhi,&rlo);
+		if(rhi<hi || (rhi==hi && rlo<=lo)) {
+			break;
+		}
+		x--;
+	}
+	while(true) {
+		multu64hilo(x+1,x+1,&rhi,&rlo);
+		if(rhi>hi || (rhi==hi && rlo>lo)) {
+			break;
+		}
+		x++;
+	}
+	return x;
+}
+
+// 2^63/(n(n-1))
+const int64_t H_SERIES_2=4611686018427387904LL;
+const int64_t H_SERIES_3=1537228672809129301LL;
+const int64_t H_SERIES_4=768614336404564650LL;
+const int64_t H_SERIES_5=461168601842738790LL;
+const int64_t H_SERIES_6=307445734561825860LL;
+const int64_t H_SERIES_7=219604096115589900LL;
+const int64_t H_SERIES_8=164703072086692425LL;
+
+// signed 1.63 multiply
+static inline int64_t mult_1_63(int64_t x, int64_t y) {
+	return mults64hi(x,y)<<1;
+}
+
+static uint64_t poisson_ptrd_huge(uint64_t* seed, uint64_t u_int, uint64_t u_frac) {
+	uint64_t u_frac32=u_frac>>32;
+	uint64_t u16=(u_int<<16)|(u_frac>>48);
+	//double smu=std::sqrt(u); // >=32 <2^24
+	uint64_t ismu=isqrt128(u_int,u_frac);
+	//double b=0.931+2.53*smu;
+	uint64_t ib=3998614553ULL+(multu64hi(ismu,11667565626621291397ULL)<<2);
+	//double a=-0.059+0.02483*b; // <2^20
+	uint64_t ia=multu64hi(ib,458032655350208166ULL)-253403070ULL;
+	//double vr=0.9277-3.6224/(b-2.0);
+	uint64_t ivr=3984441160ULL-((16705371433151369943ULL/(ib-8589934592ULL))<<2);
+	//double inv_alpha=1.1239+1.1328/(b-3.4);
+	uint64_t iinv_alpha=4827113744ULL+((10448235843349090035ULL/(ib-14602888806ULL))<<1);
 	while(true) {
-		//double smu=std::sqrt(u); // >=3.1623 <=10000
-		uint64_t ismu=fixed_sqrt_32_32(iu);
-		//double b=0.931+2.53*smu; // >=8.9316 <=25300
-		uint64_t ib=3998614553ULL+(multu64hi(ismu,11667565626621291397ULL)<<2);
-		//double a=-0.059+0.02483*b; // >=0.16277 <=629
-		uint64_t ia=multu64hi(ib,458032655350208166ULL)-253403070ULL;
-		//double vr=0.9277-3.6224/(b-2.0); // >=0.4051, <=0.9277
-		uint64_t ivr=3984441160ULL-((16705371433151369943ULL/(ib-8589934592ULL))<<2);
 		uint64_t iV=fast_rand64(seed)>>32;
 		//if(V<0.86*vr) { // V/vr<0.86
 		if(iV<multu64hi(15864199903390214389ULL,ivr)) {
@@ -432,12 +931,11 @@ uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda) {
 			//double us=0.5-abs(U); // >=0.07, <=0.5
 			uint64_t ius=2147483648ULL-abs(iU);
 			//uint64_t k=std::floor((2.0*a/us+b)*U+u+0.445);
-			uint64_t i2a_div_us=((ia<<21)/ius)<<12; //udiv64fixed(ia<<1,ius);
-			uint64_t ik=(fixed_mult64s(i2a_div_us+ib,iU)+iu+1911260447ULL)>>32;
-			return (uint32_t)ik;
+			uint64_t i2a_div_us=divu128by64(ia>>31,ia<<33,ius);
+			int64_t delta=fixed_mult64s(i2a_div_us+ib,iU)+(int64_t)u_frac32+1911260447LL;
+			return u_int+(delta>>32);
 		}
 		uint64_t it=fast_rand64(seed)>>32;
-		//double t=it/4294967296.0;
 		int64_t iU;
 		if(iV>=ivr) {
 			//U=t-0.5; // >=-0.5, <=0.5
@@ -452,29 +950,1104 @@ uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda) {
 		}
 		//double us=0.5-abs(U); // >=0, <=0.5
 		uint64_t ius=2147483648ULL-abs(iU);
-		if(ius<65536 || (ius<55834575ULL && iV>ius)) {
+		// us<2^-8 puts k more than 15 standard deviations out, where the test below always rejects,
+		// so rejecting early here keeps everything in range without changing the distribution
+		if(ius<16777216ULL || (ius<55834575ULL && iV>ius)) {
 			continue;
 		}
-		//double k=std::floor((2.0*a/us+b)*U+u+0.445); // anything
-		uint64_t i2a_div_us=((ia<<21)/ius)<<12; //udiv64fixed(ia<<1,ius);
-		int64_t ik=(fixed_mult64s(i2a_div_us+ib,iU)+(int64_t)iu+1911260447LL)>>32;
-		//double inv_alpha=1.1239+1.1328/(b-3.4); // >=1.1239, <1.3287
-		uint64_t iinv_alpha=4827113744ULL+((10448235843349090035ULL/(ib-14602888806ULL))<<1);
-		//V=V*inv_alpha/(a/(us*us)+b);
-		iV=((fixed_mult64u(iinv_alpha,iV)<<31)/((((ia<<20)/fixed_mult64u(ius,ius))<<12)+ib)<<1);
-		if(ik>=10.0) {
-			int64_t lhs=log_64_fixed(fixed_mult64u(iV,ismu));
-			int64_t rhs=((ik<<1)+1)*((log_64_fixed(iu/ik))>>1)-iu-3946810947LL+(ik<<32);
-			if(lhs>rhs) {
-				continue;
+		//double k=std::floor((2.0*a/us+b)*U+u+0.445);
+		uint64_t i2a_div_us=divu128by64(ia>>31,ia<<33,ius);
+		int64_t delta=fixed_mult64s(i2a_div_us+ib,iU)+(int64_t)u_frac32+1911260447LL;
+		// d=k-u, again anything over 16 standard deviations out is always rejected (there u*h(x)>90, and
+		// the left hand side is at least ln(2^-32))
+		int64_t id=(delta&~0xFFFFFFFFLL)-(int64_t)u_frac32;
+		uint64_t abs_d=(id<0)?-id:id;
+		if(abs_d>(ismu<<4)) {
+			continue;
+		}
+		//y=smu*V*inv_alpha/(a/(us*us)+b), with the divisor as 48.16
+		uint64_t a_div_us2=divu128by64(ia>>48,ia<<16,fixed_mult64u(ius,ius));
+		uint64_t hi,lo;
+		multu64hilo(fixed_mult64u(iinv_alpha,iV),ismu,&hi,&lo);
+		uint64_t y=divu128by64(hi>>16,(hi<<48)|(lo>>16),a_div_us2+(ib>>16));
+		int64_t lhs=log_64_fixed(y|1);
+		//x=d/u, as signed 1.63
+		int64_t x=divu128by64(abs_d>>16,abs_d<<48,u16)>>1;
+		if(id<0) {
+			x=-x;
+		}
+		int64_t g=H_SERIES_8;
+		g=H_SERIES_7-mult_1_63(x,g);
+		g=H_SERIES_6-mult_1_63(x,g);
+		g=H_SERIES_5-mult_1_63(x,g);
+		g=H_SERIES_4-mult_1_63(x,g);
+		g=H_SERIES_3-mult_1_63(x,g);
+		g=H_SERIES_2-mult_1_63(x,g);
+		int64_t u_h=mult_1_63(id,mult_1_63(x,g)); // u*h(x)=d*x*g(x)
+		int64_t half_log1p=(x>>32)-(mult_1_63(x,x)>>33);
+		// the Stirling correction 1/(12k) as in poisson_ptrd, the next term 1/(360k^3) is below 2^-53 here
+		uint64_t k=u_int+(delta>>32);
+		int64_t rhs=-u_h-half_log1p-3946810947LL-(int64_t)(357913941ULL/k);
+		if(lhs<=rhs) {
+			return u_int+(delta>>32);
+		}
+	}
+}
+
+uint64_t poisson_random_variate_integer_64(uint64_t* seed, uint64_t lambda_int, uint64_t lambda_frac) {
+	if(lambda_int<HUGE_LAMBDA_MIN) {
+		return poisson_random_variate_integer(seed,(int64_t)((lambda_int<<32)|(lambda_frac>>32)));
+	}
+	if(lambda_int>=HUGE_LAMBDA_LIMIT) {
+		return ~0ULL;
+	}
+	return poisson_ptrd_huge(seed,lambda_int,lambda_frac);
+}
+
+void poisson_random_variate_integer_fill(uint64_t* seed, int64_t lambda, uint32_t* out, size_t count) {
+	poisson_params p;
+	poisson_setup(&p,lambda);
+	for(size_t i=0;i<count;i++) {
+		out[i]=poisson_sample(seed,&p);
+	}
+}
+
+// Approximate mode: a normal variate z from an integer ziggurat (Marsaglia and Tsang, 128 layers), mapped with the
+// first Cornish-Fisher term to k=floor(lambda+sqrt(lambda)*z+(z*z-1)/6+0.5). The total variation distance from
+// Poisson is about 0.023/lambda.
+// Each variate uses exactly one word from the seed. The rare (about 1.2%) ziggurat rejections draw their extra words
+// from a private stream seeded with the rejected word, so a block of words can be transformed independently.
+
+const int ZIGGURAT_LAYERS=128;
+
+// k: |j|<k[i] is inside the rectangle of layer i, x: right edge of layer i as 3.29, f: exp(-x*x/2) as 0.32
+constexpr std::array<uint32_t,ZIGGURAT_LAYERS> ziggurat_k = {{
+	1991057938U,0U,1611602771U,1826899878U,1918584482U,1969227037U,2001281515U,2023368125U,
+	2039498179U,2051788381U,2061460127U,2069267110U,2075699398U,2081089314U,2085670119U,2089610331U,
+	2093034710U,2096037586U,2098691595U,2101053571U,2103168620U,2105072996U,2106796166U,2108362327U,
+	2109791536U,2111100552U,2112303493U,2113412330U,2114437283U,2115387130U,2116269447U,2117090813U,
+	2117856962U,2118572919U,2119243101U,2119871411U,2120461303U,2121015852U,2121537798U,2122029592U,
+	2122493434U,2122931299U,2123344971U,2123736059U,2124106020U,2124456175U,2124787725U,2125101763U,
+	2125399283U,2125681194U,2125948325U,2126201433U,2126441213U,2126668298U,2126883268U,2127086657U,
+	2127278949U,2127460589U,2127631985U,2127793506U,2127945490U,2128088244U,2128222044U,2128347141U,
+	2128463758U,2128572095U,2128672327U,2128764606U,2128849065U,2128925811U,2128994934U,2129056501U,
+	2129110560U,2129157136U,2129196237U,2129227847U,2129251929U,2129268426U,2129277255U,2129278312U,
+	2129271467U,2129256561U,2129233410U,2129201800U,2129161480U,2129112170U,2129053545U,2128985244U,
+	2128906855U,2128817916U,2128717911U,2128606255U,2128482298U,2128345305U,2128194452U,2128028813U,
+	2127847342U,2127648860U,2127432031U,2127195339U,2126937058U,2126655214U,2126347546U,2126011445U,
+	2125643893U,2125241376U,2124799783U,2124314271U,2123779094U,2123187386U,2122530867U,2121799464U,
+	2120980787U,2120059418U,2119015917U,2117825402U,2116455471U,2114863093U,2112989789U,2110753906U,
+	2108037662U,2104664315U,2100355223U,2094642347U,2086670106U,2074676188U,2054300022U,2010539237U
+}};
+
+constexpr std::array<uint32_t,ZIGGURAT_LAYERS> ziggurat_x = {{
+	1993448000U,146201151U,194815116U,229001206U,256322487U,279525082U,299945579U,318344556U,
+	335199970U,350833673U,365473756U,379288353U,392405344U,404924505U,416925354U,428472412U,
+	439618844U,450409040U,460880508U,471065264U,480990892U,490681358U,500157637U,509438218U,
+	518539497U,527476102U,536261152U,544906471U,553422769U,561819787U,570106423U,578290838U,
+	586380545U,594382482U,602303087U,610148343U,617923839U,625634806U,633286155U,640882515U,
+	648428259U,655927529U,663384265U,670802219U,678184979U,685535983U,692858536U,700155824U,
+	707430926U,714686826U,721926424U,729152547U,736367957U,743575360U,750777417U,757976748U,
+	765175941U,772377561U,779584154U,786798257U,794022403U,801259126U,808510970U,815780497U,
+	823070287U,830382953U,837721142U,845087545U,852484901U,859916008U,867383729U,874891001U,
+	882440844U,890036367U,897680782U,905377413U,913129707U,920941244U,928815755U,936757132U,
+	944769446U,952856961U,961024156U,969275745U,977616696U,986052261U,994587999U,1003229811U,
+	1011983972U,1020857169U,1029856547U,1038989756U,1048265007U,1057691134U,1067277670U,1077034920U,
+	1086974067U,1097107271U,1107447801U,1118010180U,1128810357U,1139865910U,1151196288U,1162823093U,
+	1174770424U,1187065292U,1199738123U,1212823374U,1226360298U,1240393901U,1254976152U,1270167520U,
+	1286038985U,1302674665U,1320175332U,1338663203U,1358288600U,1379239426U,1401755052U,1426147333U,
+	1452833662U,1482391519U,1515653882U,1553889107U,1599175374U,1655295889U,1730380575U,1848242462U
+}};
+
+constexpr std::array<uint32_t,ZIGGURAT_LAYERS> ziggurat_f = {{
+	4294967295U,4138629168U,4021303498U,3921492608U,3832320509U,3750550337U,3674347133U,3602548153U,
+	3534359561U,3469209559U,3406669325U,3346406958U,3288158989U,3231711889U,3176889571U,3123544680U,
+	3071552336U,3020805543U,2971211747U,2922690202U,2875169938U,2828588152U,2782888931U,2738022227U,
+	2693943011U,2650610595U,2607988051U,2566041744U,2524740924U,2484057391U,2443965202U,2404440429U,
+	2365460940U,2327006216U,2289057192U,2251596115U,2214606420U,2178072624U,2141980229U,2106315636U,
+	2071066071U,2036219517U,2001764653U,1967690803U,1933987883U,1900646360U,1867657210U,1835011885U,
+	1802702279U,1770720699U,1739059835U,1707712740U,1676672804U,1645933736U,1615489540U,1585334507U,
+	1555463189U,1525870389U,1496551150U,1467500737U,1438714630U,1410188510U,1381918251U,1353899912U,
+	1326129727U,1298604097U,1271319583U,1244272901U,1217460914U,1190880627U,1164529183U,1138403855U,
+	1112502046U,1086821281U,1061359208U,1036113588U,1011082298U,986263327U,961654771U,937254835U,
+	913061828U,889074162U,865290354U,841709021U,818328882U,795148757U,772167569U,749384340U,
+	726798198U,704408372U,682214199U,660215124U,638410700U,616800597U,595384601U,574162621U,
+	553134691U,532300982U,511661802U,491217611U,470969024U,450916828U,431061992U,411405679U,
+	391949270U,372694378U,353642875U,334796921U,316158993U,297731932U,279518985U,261523867U,
+	243750834U,226204769U,208891300U,191816943U,174989286U,158417244U,142111389U,126084423U,
+	110351849U,94932970U,79852473U,65143049U,50850174U,37041878U,23832753U,11465970U
+}};
+
+// r (the right edge of the last layer) as 32.32, and 1/r as 32.32
+const int64_t ZIGGURAT_R=14785939694LL;
+const int64_t ZIGGURAT_INV_R=1247586860LL;
+
+// 1/6 as 32.32
+const int64_t ONE_SIXTH=715827883LL;
+
+static inline int64_t ziggurat_layer_x(int32_t j, uint32_t i) {
+	return (((int64_t)j)*ziggurat_x[i])>>28;
+}
+
+static int64_t ziggurat_normal_slow(uint64_t w) {
+	uint64_t s=w;
+	while(true) {
+		uint32_t i=w&(ZIGGURAT_LAYERS-1);
+		int32_t j=(int32_t)(w>>32);
+		uint32_t aj=(j<0)?-(uint32_t)j:j;
+		if(aj<ziggurat_k[i]) {
+			return ziggurat_layer_x(j,i);
+		}
+		if(i==0) {
+			// tail beyond r
+			int64_t x,y;
+			do {
+				x=fixed_mult64s(-log_64_fixed((fast_rand64(&s)>>32)|1),ZIGGURAT_INV_R);
+				y=-log_64_fixed((fast_rand64(&s)>>32)|1);
+			} while((y<<1)<fixed_mult64s(x,x));
+			return (j<0)?-(ZIGGURAT_R+x):(ZIGGURAT_R+x);
+		}
+		int64_t x=ziggurat_layer_x(j,i);
+		uint32_t f=ziggurat_f[i]+multu32hi(fast_rand64(&s)>>32,ziggurat_f[i-1]-ziggurat_f[i]);
+		if(log_64_fixed(f)<-(fixed_mult64s(x,x)>>1)) {
+			return x;
+		}
+		w=fast_rand64(&s);
+	}
+}
+
+// standard normal as 32.32 from one random word
+static inline int64_t ziggurat_normal(uint64_t w) {
+	uint32_t i=w&(ZIGGURAT_LAYERS-1);
+	int32_t j=(int32_t)(w>>32);
+	uint32_t aj=(j<0)?-(uint32_t)j:j;
+	if(aj<ziggurat_k[i]) {
+		return ziggurat_layer_x(j,i);
+	}
+	return ziggurat_normal_slow(w);
+}
+
+static inline uint32_t poisson_approx_from_normal(int64_t z, int64_t lambda, int64_t sigma) {
+	int64_t y=lambda+fixed_mult64s(sigma,z)+fixed_mult64s(fixed_mult64s(z,z)-(1LL<<32),ONE_SIXTH)+(1LL<<31);
+	return (y<0)?0:(uint32_t)(y>>32);
+}
+
+uint32_t poisson_random_variate_integer_approx(uint64_t* seed, int64_t lambda, int64_t threshold) {
+	// lambda<=0 gives 0 from the exact path, and would take the square root of 0
+	if(lambda<threshold || lambda<=0) {
+		return poisson_random_variate_integer(seed,lambda);
+	}
+	return poisson_approx_from_normal(ziggurat_normal(fast_rand64(seed)),lambda,fixed_sqrt_32_32(lambda));
+}
+
+const size_t APPROX_BLOCK=64;
+
+void poisson_random_variate_integer_approx_fill(uint64_t* seed, int64_t lambda, int64_t threshold, uint32_t* out, size_t count) {
+	// lambda<=0 gives 0 from the exact path, and would take the square root of 0
+	if(lambda<threshold || lambda<=0) {
+		poisson_random_variate_integer_fill(seed,lambda,out,count);
+		return;
+	}
+	int64_t sigma=fixed_sqrt_32_32(lambda);
+	uint64_t w[APPROX_BLOCK];
+	for(size_t n=0;n<count;n+=APPROX_BLOCK) {
+		size_t m=(count-n<APPROX_BLOCK)?count-n:APPROX_BLOCK;
+		// the random words are a serial chain, but the transforms are independent of each other
+		for(size_t i=0;i<m;i++) {
+			w[i]=fast_rand64(seed);
+		}
+		for(size_t i=0;i<m;i++) {
+			out[n+i]=poisson_approx_from_normal(ziggurat_normal(w[i]),lambda,sigma);
+		}
+	}
+}
+
+// Negative binomial as a gamma mixed Poisson: lambda~Gamma(shape,mean/shape), k~Poisson(lambda).
+// The gamma variate is Marsaglia and Tsang's method, using the ziggurat normal above. For shape<1 it uses
+// Gamma(shape)=Gamma(shape+1)*U^(1/shape).
+
+// 0.0331 and 1/3 as 32.32
+const int64_t GAMMA_SQUEEZE=142163417LL;
+const int64_t ONE_THIRD=1431655765LL;
+
+struct gamma_params {
+	int64_t d; // shape-1/3
+	int64_t c; // 1/sqrt(9d)
+	int64_t inv_shape; // 1/shape, only used if boost
+	bool boost; // shape<1
+};
+
+// smallest shape used, 2^-16. Below this 1/shape would overflow, and nearly all draws are 0 anyway.
+const int64_t MIN_SHAPE=1LL<<16;
+
+static inline void gamma_setup(gamma_params* g, int64_t shape) {
+	g->boost=(shape<(1LL<<32));
+	if(g->boost) {
+		g->inv_shape=divu128by64(1,0,shape);
+		shape+=1LL<<32;
+	}
+	g->d=shape-ONE_THIRD;
+	g->c=divu128by64(1,0,3*fixed_sqrt_32_32(g->d));
+}
+
+// 2^x for x<=0, all 32.32
+static inline uint64_t exp2_negative(int64_t x) {
+	int64_t ip=-(x>>32);
+	if(ip>=32) {
+		return 0;
+	}
+	return (((uint64_t)p_exp2_32_internal((uint32_t)x))<<2)>>ip;
+}
+
+// Gamma(shape,1) as 32.32
+static inline uint64_t gamma_sample(uint64_t* seed, const gamma_params* g) {
+	uint64_t ret;
+	while(true) {
+		int64_t z=ziggurat_normal(fast_rand64(seed));
+		int64_t t=(1LL<<32)+fixed_mult64s(g->c,z);
+		if(t<=0) {
+			continue;
+		}
+		int64_t v=fixed_mult64s(fixed_mult64s(t,t),t);
+		// v below 2^-32 would always be rejected, and can't go in log_64_fixed
+		if(v<=0) {
+			continue;
+		}
+		int64_t u=(fast_rand64(seed)>>32)|1;
+		int64_t z2=fixed_mult64s(z,z);
+		//if(u<1-0.0331*z^4 || ln(u)<z^2/2+d*(1-v+ln(v)))
+		if(u<(1LL<<32)-fixed_mult64s(GAMMA_SQUEEZE,fixed_mult64s(z2,z2)) ||
+			log_64_fixed(u)<(z2>>1)+fixed_mult64s(g->d,(1LL<<32)-v+log_64_fixed(v))) {
+			ret=fixed_mult64u(g->d,v);
+			break;
+		}
+	}
+	if(g->boost) {
+		//ret*=U^(1/shape)=2^(log2(U)/shape)
+		int64_t ln_u=fixed_mult64s(log_64_fixed((fast_rand64(seed)>>32)|1),g->inv_shape);
+		int64_t log2_u=-(int64_t)(multu64hi(-ln_u,P_LN2_INV_2_POW_63)<<1);
+		ret=fixed_mult64u(ret,exp2_negative(log2_u));
+	}
+	return ret;
+}
+
+struct negative_binomial_params {
+	gamma_params gamma;
+	uint64_t scale; // mean/shape=scale/2^scale_shift, with the top bit of scale set
+	uint32_t scale_shift;
+};
+
+// everything that only depends on mean and shape, so the fill doesn't divide per variate
+static inline void negative_binomial_setup(negative_binomial_params* nb, int64_t mean, int64_t shape) {
+	if(shape<MIN_SHAPE) {
+		shape=MIN_SHAPE;
+	}
+	gamma_setup(&nb->gamma,shape);
+	uint32_t mean_lz=clz64(mean);
+	uint32_t shape_lz=clz64(shape);
+	//scale_shift is between 1 and 126
+	nb->scale_shift=63+mean_lz-shape_lz+((((uint64_t)mean)<<mean_lz)<(((uint64_t)shape)<<shape_lz));
+	uint64_t hi=(nb->scale_shift>=64)?((uint64_t)mean)<<(nb->scale_shift-64):((uint64_t)mean)>>(64-nb->scale_shift);
+	uint64_t lo=(nb->scale_shift>=64)?0:((uint64_t)mean)<<nb->scale_shift;
+	nb->scale=divu128by64(hi,lo,shape);
+}
+
+static inline uint32_t negative_binomial_sample(uint64_t* seed, const negative_binomial_params* nb) {
+	//lambda=gamma*mean/shape
+	uint64_t hi,lo;
+	multu64hilo(gamma_sample(seed,&nb->gamma),nb->scale,&hi,&lo);
+	uint64_t lambda;
+	if(nb->scale_shift>=64) {
+		lambda=hi>>(nb->scale_shift-64);
+	} else if((hi>>nb->scale_shift)!=0) {
+		lambda=~0ULL;
+	} else {
+		lambda=(hi<<(64-nb->scale_shift))|(lo>>nb->scale_shift);
+	}
+	// lambda>=2^48 gives ~0 from poisson_random_variate_integer_64, which saturates like anything above 2^32
+	uint64_t k=poisson_random_variate_integer_64(seed,lambda>>32,lambda<<32);
+	return (k>0xFFFFFFFFULL)?0xFFFFFFFFU:(uint32_t)k;
+}
+
+uint32_t poisson_random_variate_negative_binomial(uint64_t* seed, int64_t mean, int64_t shape) {
+	if(mean<=0 || shape<=0) {
+		return 0;
+	}
+	negative_binomial_params nb;
+	negative_binomial_setup(&nb,mean,shape);
+	return negative_binomial_sample(seed,&nb);
+}
+
+void poisson_random_variate_negative_binomial_fill(uint64_t* seed, int64_t mean, int64_t shape, uint32_t* out, size_t count) {
+	if(mean<=0 || shape<=0) {
+		for(size_t i=0;i<count;i++) {
+			out[i]=0;
+		}
+		return;
+	}
+	negative_binomial_params nb;
+	negative_binomial_setup(&nb,mean,shape);
+	for(size_t i=0;i<count;i++) {
+		out[i]=negative_binomial_sample(seed,&nb);
+	}
+}
+
+// Histogram of many draws. Rather than sample the multinomial with conditional binomials, it is Poissonized: the
+// bins are independent Poisson(mu*p_k) for mu a little less than draws, which gives a multinomial split of a
+// Poisson(mu) total T. If T<=draws the other draws-T are made one at a time, which makes the total exactly a
+// multinomial of draws, and if T>draws (about 0.1% of the time) the bins are drawn again.
+// p_k is w_k/W, where w_k comes from the recurrence p_{k+1}=p_k*lambda/(k+1) out from the mode.
+
+// calls f(k,w_k) for every k with w_k>0, where w_mode=w_mode
+template<typename F> static inline void poisson_weights(int64_t lambda, uint64_t w_mode, F f) {
+	uint64_t mode=lambda>>32;
+	uint64_t w=w_mode;
+	uint64_t hi,lo;
+	for(uint64_t k=mode;w>0;k++) {
+		f(k,w);
+		multu64hilo(w,lambda,&hi,&lo);
+		w=divu128by64(hi,lo,(k+1)<<32);
+	}
+	w=w_mode;
+	for(uint64_t k=mode;k>0;k--) {
+		multu64hilo(w,k<<32,&hi,&lo);
+		w=divu128by64(hi,lo,lambda);
+		if(w==0) {
+			break;
+		}
+		f(k-1,w);
+	}
+}
+
+const uint32_t HISTOGRAM_BLOCK=256;
+
+static inline void poisson_histogram_draws(uint64_t* seed, const poisson_params* p, uint64_t draws, uint64_t* hist, uint32_t hist_size) {
+	uint32_t out[HISTOGRAM_BLOCK];
+	while(draws>0) {
+		uint32_t n=(draws<HISTOGRAM_BLOCK)?(uint32_t)draws:HISTOGRAM_BLOCK;
+		for(uint32_t i=0;i<n;i++) {
+			out[i]=poisson_sample(seed,p);
+		}
+		for(uint32_t i=0;i<n;i++) {
+			hist[(out[i]<hist_size-1)?out[i]:hist_size-1]++;
+		}
+		draws-=n;
+	}
+}
+
+// the bins go through poisson_random_variate_integer_64, which clamps means at 2^48
+const uint64_t HISTOGRAM_MAX_DRAWS=1ULL<<48;
+
+int poisson_random_variate_integer_histogram(uint64_t* seed, int64_t lambda, uint64_t draws, uint64_t* hist, uint32_t hist_size) {
+	if(hist_size==0 || draws>=HISTOGRAM_MAX_DRAWS) {
+		return -1;
+	}
+	for(uint32_t k=0;k<hist_size;k++) {
+		hist[k]=0;
+	}
+	if(lambda<=0) {
+		hist[0]=draws;
+		return 0;
+	}
+	poisson_params p;
+	poisson_setup(&p,lambda);
+	// the weights cover about 20 standard deviations, so only worth it when there are many more draws than that
+	uint64_t root_lambda=fixed_sqrt_32_32(lambda)>>32;
+	if(draws<4096+16*root_lambda || lambda>=(1LL<<62)) {
+		poisson_histogram_draws(seed,&p,draws,hist,hist_size);
+		return 0;
+	}
+	// scale the weights so they add up to less than 2^63
+	uint64_t sum_hi=0,sum_lo=0;
+	poisson_weights(lambda,1ULL<<62,[&](uint64_t, uint64_t w) {
+		sum_lo+=w;
+		sum_hi+=(sum_lo<w);
+	});
+	uint32_t shift=(sum_hi>0)?(65-clz64(sum_hi)):((sum_lo>>63)?1:0);
+	// the individual bins' weights go in hist for now, the rest are added up for the last bin
+	uint64_t total=0,tail=0;
+	poisson_weights(lambda,(1ULL<<62)>>shift,[&](uint64_t k, uint64_t w) {
+		total+=w;
+		if(k<hist_size-1) {
+			hist[k]=w;
+		} else {
+			tail+=w;
+		}
+	});
+	hist[hist_size-1]=tail;
+	// mu=draws-3*sqrt(draws)
+	uint64_t mu=draws-3*(fixed_sqrt_32_32(draws)>>16);
+	std::vector<uint64_t> counts(hist_size);
+	while(true) {
+		uint64_t t=0;
+		for(uint32_t k=0;k<hist_size;k++) {
+			uint64_t mean_hi,mean_lo;
+			uint64_t p_k=(hist[k]<total)?divu128by64(hist[k],0,total):~0ULL;
+			multu64hilo(mu,p_k,&mean_hi,&mean_lo);
+			counts[k]=(hist[k]>0)?poisson_random_variate_integer_64(seed,mean_hi,mean_lo):0;
+			t+=counts[k];
+		}
+		if(t<=draws) {
+			for(uint32_t k=0;k<hist_size;k++) {
+				hist[k]=counts[k];
+			}
+			poisson_histogram_draws(seed,&p,draws-t,hist,hist_size);
+			return 0;
+		}
+	}
+}
+
+// Tuned mode: the same three regimes, with crossovers measured on this machine rather than 18 and 38
+
+const int64_t PTRD_MIN_LAMBDA=10LL<<32; // PTRD is only valid above 10
+const uint32_t CALIBRATION_MAX_LAMBDA=64; // PTRD is always much faster beyond this
+const uint32_t CALIBRATION_DRAWS=1024;
+const uint32_t CALIBRATION_REPEATS=3;
+
+static inline void poisson_thresholds_clamp(poisson_random_variate_thresholds* t) {
+	const int64_t max_lambda=(int64_t)CALIBRATION_MAX_LAMBDA<<32;
+	t->small_max=(t->small_max<0)?0:((t->small_max>max_lambda)?max_lambda:t->small_max);
+	t->mid_max=(t->mid_max<t->small_max)?t->small_max:((t->mid_max>max_lambda)?max_lambda:t->mid_max);
+	if(t->mid_max<PTRD_MIN_LAMBDA) {
+		t->mid_max=PTRD_MIN_LAMBDA;
+	}
+}
+
+static inline void poisson_setup_tuned(poisson_params* p, int64_t lambda, const poisson_random_variate_thresholds* t) {
+	p->lambda=lambda;
+	if(lambda<=0) {
+		return;
+	}
+	if(lambda<=t->mid_max) {
+		poisson_setup_digits(p,lambda);
+		return;
+	}
+	poisson_setup_ptrd(p,lambda);
+}
+
+static inline uint32_t poisson_sample_tuned(uint64_t* seed, const poisson_params* p, const poisson_random_variate_thresholds* t) {
+	if(p->lambda<=0) {
+		return 0;
+	}
+	if(p->lambda<=t->small_max) {
+		return poisson_small(seed,p->int_digits,p->exp2_frac);
+	}
+	if(p->lambda<=t->mid_max) {
+		return poisson_mid(seed,p->int_digits,p->exp2_frac);
+	}
+	return poisson_ptrd(seed,p);
+}
+
+void poisson_random_variate_thresholds_default(poisson_random_variate_thresholds* t) {
+	t->small_max=77309411328LL; // 18
+	t->mid_max=163208757248LL; // 38
+}
+
+// best of CALIBRATION_REPEATS, in nanoseconds for CALIBRATION_DRAWS draws
+static double poisson_time_regime(int64_t lambda, uint32_t regime) {
+	poisson_params p;
+	poisson_setup_digits(&p,lambda);
+	if(regime==2) {
+		poisson_setup_ptrd(&p,lambda);
+	}
+	double best=1e300;
+	uint64_t seed=lambda;
+	volatile uint32_t sink=0;
+	for(uint32_t r=0;r<CALIBRATION_REPEATS;r++) {
+		uint32_t total=0;
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		for(uint32_t i=0;i<CALIBRATION_DRAWS;i++) {
+			switch(regime) {
+				case 0: total+=poisson_small(&seed,p.int_digits,p.exp2_frac); break;
+				case 1: total+=poisson_mid(&seed,p.int_digits,p.exp2_frac); break;
+				default: total+=poisson_ptrd(&seed,&p); break;
 			}
-			rhs-=(357913941ULL-(4294967296ULL/(360*ik*ik)))/ik;
-			if(lhs>rhs) {
-				continue;
+		}
+		double t=std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count();
+		sink=sink+total;
+		best=(t<best)?t:best;
+	}
+	return best;
+}
+
+void poisson_random_variate_thresholds_calibrate(poisson_random_variate_thresholds* t) {
+	// times[i][r] is regime r at lambda=i+1, then the crossovers are the split of 1..CALIBRATION_MAX_LAMBDA into
+	// small, mid and PTRD runs with the least total time
+	double times[CALIBRATION_MAX_LAMBDA][3];
+	double sums[CALIBRATION_MAX_LAMBDA+1][3];
+	for(uint32_t r=0;r<3;r++) {
+		sums[0][r]=0;
+	}
+	for(uint32_t i=0;i<CALIBRATION_MAX_LAMBDA;i++) {
+		int64_t lambda=(int64_t)(i+1)<<32;
+		for(uint32_t r=0;r<3;r++) {
+			times[i][r]=(r==2 && lambda<PTRD_MIN_LAMBDA)?1e300:poisson_time_regime(lambda,r);
+			sums[i+1][r]=sums[i][r]+times[i][r];
+		}
+	}
+	double best=1e300;
+	for(uint32_t small=0;small<=CALIBRATION_MAX_LAMBDA;small++) {
+		for(uint32_t mid=small;mid<=CALIBRATION_MAX_LAMBDA;mid++) {
+			double total=sums[small][0]+(sums[mid][1]-sums[small][1])+(sums[CALIBRATION_MAX_LAMBDA][2]-sums[mid][2]);
+			if(total<best) {
+				best=total;
+				t->small_max=(int64_t)small<<32;
+				t->mid_max=(int64_t)mid<<32;
 			}
-			return (uint32_t)ik;
-		} else if(0<=ik && log_64_fixed(iV)<((int64_t)ik)*log_64_fixed(iu)-(int64_t)iu-log_fact_table_fixed[ik]) {
-			return (uint32_t)ik;
 		}
 	}
+	poisson_thresholds_clamp(t);
+}
+
+int poisson_random_variate_thresholds_save(const poisson_random_variate_thresholds* t, const char* path) {
+	FILE* f=fopen(path,"w");
+	if(!f) {
+		return -1;
+	}
+	int ok=fprintf(f,"poisson_random_variate_thresholds 1\n%lld %lld\n",(long long)t->small_max,(long long)t->mid_max)>0;
+	return (fclose(f)==0 && ok)?0:-1;
+}
+
+int poisson_random_variate_thresholds_load(poisson_random_variate_thresholds* t, const char* path) {
+	FILE* f=fopen(path,"r");
+	if(!f) {
+		return -1;
+	}
+	int version=0;
+	long long small_max,mid_max;
+	int n=fscanf(f,"poisson_random_variate_thresholds %d %lld %lld",&version,&small_max,&mid_max);
+	fclose(f);
+	if(n!=3 || version!=1) {
+		return -1;
+	}
+	t->small_max=small_max;
+	t->mid_max=mid_max;
+	poisson_thresholds_clamp(t);
+	return 0;
+}
+
+// the thresholds may have been filled in by the caller, so they are clamped again here
+uint32_t poisson_random_variate_integer_tuned(uint64_t* seed, int64_t lambda, const poisson_random_variate_thresholds* t) {
+	poisson_random_variate_thresholds c=*t;
+	poisson_thresholds_clamp(&c);
+	poisson_params p;
+	poisson_setup_tuned(&p,lambda,&c);
+	return poisson_sample_tuned(seed,&p,&c);
+}
+
+void poisson_random_variate_integer_tuned_fill(uint64_t* seed, int64_t lambda, const poisson_random_variate_thresholds* t, uint32_t* out, size_t count) {
+	poisson_random_variate_thresholds c=*t;
+	poisson_thresholds_clamp(&c);
+	poisson_params p;
+	poisson_setup_tuned(&p,lambda,&c);
+	for(size_t i=0;i<count;i++) {
+		out[i]=poisson_sample_tuned(seed,&p,&c);
+	}
+}
+
+// Bounded latency mode. A Walker alias table for lambda gives a variate from exactly one random word: the top
+// bits pick one of 2^bits buckets, and the rest decide between the bucket's own k and its alias. The weights come
+// from poisson_weights starting at 2^62, so only tail probabilities below about 2^-62 of the mode's are left out,
+// and are scaled so that every bucket holds 2^(63-bits) of a total of 2^63.
+// For lambda>38 PTRD is tried first, but at most max_trials times. Each trial is independent and an accepted one
+// is Poisson, so using the table once they run out still gives a Poisson variate, and otherwise the results and
+// random words used are the same as poisson_random_variate_integer.
+
+struct poisson_alias {
+	uint64_t keep; // the bucket's own k is used if the bits below the bucket index are less than this
+	uint32_t alias;
+};
+
+struct poisson_random_variate_table {
+	poisson_params p;
+	uint32_t k_min; // the k of bucket 0
+	uint32_t bits;
+	poisson_alias* buckets;
+};
+
+poisson_random_variate_table* poisson_random_variate_table_create(int64_t lambda) {
+	poisson_random_variate_table* t=new poisson_random_variate_table;
+	poisson_setup(&t->p,lambda);
+	uint64_t k_min=0,k_max=0,mode=0;
+	uint64_t sum_hi=0,sum_lo=1;
+	if(lambda>0) {
+		mode=lambda>>32;
+		k_min=mode;
+		k_max=mode;
+		sum_lo=0;
+		poisson_weights(lambda,1ULL<<62,[&](uint64_t k, uint64_t w) {
+			k_min=(k<k_min)?k:k_min;
+			k_max=(k>k_max)?k:k_max;
+			sum_lo+=w;
+			sum_hi+=(sum_lo<w);
+		});
+	}
+	uint64_t count=k_max-k_min+1;
+	uint32_t bits=1;
+	while((1ULL<<bits)<count) {
+		bits++;
+	}
+	uint64_t n=1ULL<<bits;
+	uint64_t* q=new uint64_t[n];
+	for(uint64_t i=0;i<n;i++) {
+		q[i]=0;
+	}
+	if(lambda>0) {
+		// q_i=w_i*2^63/sum, with the sum shifted down to below 2^63
+		uint32_t shift=(sum_hi>0)?(65-clz64(sum_hi)):((sum_lo>>63)?1:0);
+		uint64_t total=(shift==0)?sum_lo:((sum_hi<<(64-shift))|(sum_lo>>shift));
+		poisson_weights(lambda,1ULL<<62,[&](uint64_t k, uint64_t w) {
+			q[k-k_min]=divu128by64(w>>(1+shift),w<<(63-shift),total);
+		});
+	}
+	// the rounding shortfall goes to the mode
+	uint64_t left=1ULL<<63;
+	for(uint64_t i=0;i<n;i++) {
+		left-=q[i];
+	}
+	q[mode-k_min]+=left;
+	// Vose's method, exact since everything is an integer
+	const uint64_t cap=1ULL<<(63-bits);
+	uint32_t* small=new uint32_t[n];
+	uint32_t* large=new uint32_t[n];
+	uint64_t small_count=0,large_count=0;
+	for(uint64_t i=0;i<n;i++) {
+		if(q[i]<cap) {
+			small[small_count++]=(uint32_t)i;
+		} else {
+			large[large_count++]=(uint32_t)i;
+		}
+	}
+	t->k_min=(uint32_t)k_min;
+	t->bits=bits;
+	t->buckets=new poisson_alias[n];
+	while(small_count>0 && large_count>0) {
+		uint32_t s=small[--small_count];
+		uint32_t l=large[large_count-1];
+		t->buckets[s].keep=q[s]<<(bits+1);
+		t->buckets[s].alias=(uint32_t)(k_min+l);
+		q[l]-=cap-q[s];
+		if(q[l]<cap) {
+			large_count--;
+			small[small_count++]=l;
+		}
+	}
+	// these are all exactly cap
+	while(large_count>0) {
+		uint32_t l=large[--large_count];
+		t->buckets[l].keep=~0ULL;
+		t->buckets[l].alias=(uint32_t)(k_min+l);
+	}
+	delete[] small;
+	delete[] large;
+	delete[] q;
+	return t;
+}
+
+void poisson_random_variate_table_destroy(poisson_random_variate_table* t) {
+	delete[] t->buckets;
+	delete t;
+}
+
+static inline uint32_t poisson_table_sample(uint64_t* seed, const poisson_random_variate_table* t) {
+	uint64_t r=fast_rand64(seed);
+	uint64_t i=r>>(64-t->bits);
+	const poisson_alias* b=&t->buckets[i];
+	return ((r<<t->bits)<b->keep)?t->k_min+(uint32_t)i:b->alias;
+}
+
+uint32_t poisson_random_variate_table_sample(uint64_t* seed, const poisson_random_variate_table* t) {
+	return poisson_table_sample(seed,t);
+}
+
+static inline uint32_t poisson_bounded_sample(uint64_t* seed, const poisson_random_variate_table* t, uint32_t max_trials) {
+	if(t->p.lambda>163208757248LL) { // 38
+		uint32_t k;
+		for(uint32_t i=0;i<max_trials;i++) {
+			if(poisson_ptrd_trial(seed,&t->p,&k)) {
+				return k;
+			}
+		}
+	}
+	return poisson_table_sample(seed,t);
+}
+
+uint32_t poisson_random_variate_integer_bounded(uint64_t* seed, const poisson_random_variate_table* t, uint32_t max_trials) {
+	return poisson_bounded_sample(seed,t,max_trials);
+}
+
+void poisson_random_variate_integer_bounded_fill(uint64_t* seed, const poisson_random_variate_table* t, uint32_t max_trials, uint32_t* out, size_t count) {
+	for(size_t i=0;i<count;i++) {
+		out[i]=poisson_bounded_sample(seed,t,max_trials);
+	}
+}
+
+// Fixed consumption: the bounded mode run on a copy of the seed with as many PTRD trials as fit in words-1 random
+// words, leaving at least one for the table. Since fast_rand64 just adds RAND_INCREMENT, skipping the unused words
+// and skipping whole variates is a single multiply and add. words=0 is treated as 1, since every variate needs a word.
+
+static inline uint32_t poisson_fixed_words(uint32_t words) {
+	return (words>0)?words:1;
+}
+
+uint32_t poisson_random_variate_integer_fixed(uint64_t* seed, const poisson_random_variate_table* t, uint32_t words) {
+	words=poisson_fixed_words(words);
+	uint64_t s=*seed;
+	*seed+=words*RAND_INCREMENT;
+	return poisson_bounded_sample(&s,t,(words-1)>>1);
+}
+
+void poisson_random_variate_integer_fixed_fill(uint64_t* seed, const poisson_random_variate_table* t, uint32_t words, uint32_t* out, size_t count) {
+	words=poisson_fixed_words(words);
+	uint32_t max_trials=(words-1)>>1;
+	uint64_t step=words*RAND_INCREMENT;
+	uint64_t s=*seed;
+	for(size_t i=0;i<count;i++) {
+		uint64_t v=s;
+		out[i]=poisson_bounded_sample(&v,t,max_trials);
+		s+=step;
+	}
+	*seed=s;
+}
+
+void poisson_random_variate_skip(uint64_t* seed, uint64_t count, uint32_t words) {
+	words=poisson_fixed_words(words);
+	*seed+=count*words*RAND_INCREMENT;
+}
+
+// Independent streams, one seed per item. The lambda<=18 loop is one long serial chain of multiplies,
+// so run 4 streams side by side in registers to let the processor overlap them. When a lane finishes it
+// writes its result and picks up the next small lambda item.
+
+struct poisson_stream_lane {
+	size_t item;
+	uint64_t seed;
+	uint64_t start;
+	int32_t int_digits;
+	uint32_t ret;
+};
+
+// Where the streams kernel finds item i: the seed, lambda and result are at byte offsets i*stride from their bases,
+// so that they can be fields of an array of structs. Plain arrays are strides of 8, 8 and 4.
+// L is the type of lambda, either fixed 32.32 or double.
+
+const size_t PREFETCH_AHEAD=16; // items
+
+template<typename L> struct poisson_items {
+	uint8_t* seeds;
+	size_t seed_stride;
+	const uint8_t* lambdas;
+	size_t lambda_stride;
+	uint8_t* out;
+	size_t out_stride;
+	size_t count;
+};
+
+static inline int64_t poisson_fixed_lambda(int64_t lambda) {
+	return lambda;
+}
+
+// 2^31 and up doesn't fit in 32.32, so it becomes the largest value that does
+static inline int64_t poisson_fixed_lambda(double lambda) {
+	if(!(lambda>0)) { // also NaN
+		return 0;
+	}
+	return (lambda<2147483648.0)?(int64_t)(lambda*4294967296.0):INT64_MAX;
+}
+
+template<typename L> static inline uint64_t* poisson_item_seed(const poisson_items<L>* items, size_t i) {
+	return (uint64_t*)(items->seeds+i*items->seed_stride);
+}
+
+// also starts loading the item PREFETCH_AHEAD on, as the callers go through the items in order
+template<typename L> static inline int64_t poisson_item_lambda(const poisson_items<L>* items, size_t i) {
+	if(i+PREFETCH_AHEAD<items->count) {
+		size_t j=i+PREFETCH_AHEAD;
+		prefetch(items->lambdas+j*items->lambda_stride);
+		prefetch(items->seeds+j*items->seed_stride);
+		prefetch(items->out+j*items->out_stride);
+	}
+	return poisson_fixed_lambda(*(const L*)(items->lambdas+i*items->lambda_stride));
+}
+
+template<typename L> static inline uint32_t* poisson_item_out(const poisson_items<L>* items, size_t i) {
+	return (uint32_t*)(items->out+i*items->out_stride);
+}
+
+static inline bool poisson_stream_is_small(int64_t lambda) {
+	return 0<lambda && lambda<=77309411328LL; // 18
+}
+
+template<typename L> static inline uint32_t poisson_stream_pull(poisson_stream_lane* l, size_t* next, const poisson_items<L>* items) {
+	int64_t lambda=0;
+	while(*next<items->count && !poisson_stream_is_small(lambda=poisson_item_lambda(items,*next))) {
+		(*next)++;
+	}
+	if(*next==items->count) {
+		// an idle lane keeps stepping on a dummy seed, but never finishes
+		l->int_digits=0x7FFFFFFF;
+		return 0;
+	}
+	size_t i=(*next)++;
+	uint64_t num_digits=multu64hi(lambda,P_LN2_INV_2_POW_63)<<1;
+	l->item=i;
+	l->seed=*poisson_item_seed(items,i);
+	l->start=((uint64_t)p_exp2_32_internal(num_digits&0xFFFFFFFF))<<33;
+	l->int_digits=num_digits>>32;
+	l->ret=-1;
+	return 1;
+}
+
+static inline void poisson_stream_step(poisson_stream_lane* l) {
+	uint64_t x=(fast_rand64(&l->seed)|1);
+	uint64_t start=multu64hi(l->start,x);
+	uint32_t z=clz64(start);
+	l->int_digits-=z;
+	l->start=start<<z;
+	l->ret++;
+}
+
+template<typename L> static inline uint32_t poisson_stream_finish(poisson_stream_lane* l, size_t* next, const poisson_items<L>* items) {
+	if(l->int_digits>=0) {
+		return 0;
+	}
+	*poisson_item_out(items,l->item)=l->ret;
+	*poisson_item_seed(items,l->item)=l->seed;
+	return 1-poisson_stream_pull(l,next,items);
+}
+
+template<typename L> static void poisson_streams(const poisson_items<L>* items) {
+	size_t next=0;
+	poisson_stream_lane l0={0,0,0x8000000000000000ULL,0,0};
+	poisson_stream_lane l1=l0,l2=l0,l3=l0;
+	uint32_t live=poisson_stream_pull(&l0,&next,items);
+	live+=poisson_stream_pull(&l1,&next,items);
+	live+=poisson_stream_pull(&l2,&next,items);
+	live+=poisson_stream_pull(&l3,&next,items);
+	while(live>0) {
+		// step every lane unconditionally so the chains stay independent and branch free
+		poisson_stream_step(&l0);
+		poisson_stream_step(&l1);
+		poisson_stream_step(&l2);
+		poisson_stream_step(&l3);
+		live-=poisson_stream_finish(&l0,&next,items);
+		live-=poisson_stream_finish(&l1,&next,items);
+		live-=poisson_stream_finish(&l2,&next,items);
+		live-=poisson_stream_finish(&l3,&next,items);
+	}
+	for(size_t i=0;i<items->count;i++) {
+		int64_t lambda=poisson_item_lambda(items,i);
+		if(!poisson_stream_is_small(lambda)) {
+			*poisson_item_out(items,i)=poisson_random_variate_integer(poisson_item_seed(items,i),lambda);
+		}
+	}
+}
+
+void poisson_random_variate_integer_streams(uint64_t* seeds, const int64_t* lambdas, uint32_t* out, size_t count) {
+	poisson_items<int64_t> items={(uint8_t*)seeds,sizeof(uint64_t),(const uint8_t*)lambdas,sizeof(int64_t),(uint8_t*)out,sizeof(uint32_t),count};
+	poisson_streams(&items);
+}
+
+const size_t STREAMS_BLOCK=256; // items
+
+static inline void poisson_streams_fixed(const poisson_items<int64_t>* items) {
+	poisson_streams(items);
+}
+
+// the kernel reads every lambda twice (once to find the small ones and once for the rest), so the doubles are
+// converted to 32.32 once, a block at a time, and the block is run from the converted copy
+static void poisson_streams_fixed(const poisson_items<double>* items) {
+	int64_t lambdas[STREAMS_BLOCK];
+	for(size_t start=0;start<items->count;start+=STREAMS_BLOCK) {
+		size_t n=(items->count-start<STREAMS_BLOCK)?items->count-start:STREAMS_BLOCK;
+		for(size_t i=0;i<n;i++) {
+			lambdas[i]=poisson_fixed_lambda(*(const double*)(items->lambdas+(start+i)*items->lambda_stride));
+		}
+		poisson_items<int64_t> block={items->seeds+start*items->seed_stride,items->seed_stride,(const uint8_t*)lambdas,sizeof(int64_t),items->out+start*items->out_stride,items->out_stride,n};
+		poisson_streams(&block);
+	}
+}
+
+// with seed_stride 0 all the items share one seed, so they have to be done in order
+template<typename L> static inline void poisson_streams_strided(const poisson_items<L>* items) {
+	if(items->seed_stride!=0) {
+		poisson_streams_fixed(items);
+		return;
+	}
+	uint64_t* seed=poisson_item_seed(items,0);
+	for(size_t i=0;i<items->count;i++) {
+		*poisson_item_out(items,i)=poisson_random_variate_integer(seed,poisson_item_lambda(items,i));
+	}
+}
+
+void poisson_random_variate_integer_streams_strided(uint64_t* seeds, size_t seed_stride, const int64_t* lambdas, size_t lambda_stride, uint32_t* out, size_t out_stride, size_t count) {
+	poisson_items<int64_t> items={(uint8_t*)seeds,seed_stride,(const uint8_t*)lambdas,lambda_stride,(uint8_t*)out,out_stride,count};
+	poisson_streams_strided(&items);
+}
+
+void poisson_random_variate_integer_streams_strided_double(uint64_t* seeds, size_t seed_stride, const double* lambdas, size_t lambda_stride, uint32_t* out, size_t out_stride, size_t count) {
+	poisson_items<double> items={(uint8_t*)seeds,seed_stride,(const uint8_t*)lambdas,lambda_stride,(uint8_t*)out,out_stride,count};
+	poisson_streams_strided(&items);
+}
+
+// saturates anything that doesn't fit in T, and returns how many did
+template<typename T> static inline size_t poisson_fill_narrow(uint64_t* seed, int64_t lambda, T* out, size_t count) {
+	const uint32_t max_value=(T)~(T)0;
+	poisson_params p;
+	poisson_setup(&p,lambda);
+	size_t saturated=0;
+	for(size_t i=0;i<count;i++) {
+		uint32_t x=poisson_sample(seed,&p);
+		saturated+=(x>max_value);
+		out[i]=(T)((x>max_value)?max_value:x);
+	}
+	return saturated;
+}
+
+size_t poisson_random_variate_integer_fill_u16(uint64_t* seed, int64_t lambda, uint16_t* out, size_t count) {
+	return poisson_fill_narrow(seed,lambda,out,count);
+}
+
+size_t poisson_random_variate_integer_fill_u8(uint64_t* seed, int64_t lambda, uint8_t* out, size_t count) {
+	return poisson_fill_narrow(seed,lambda,out,count);
+}
+
+uint64_t poisson_random_variate_derive_seed(uint64_t seed, uint64_t index) {
+	uint64_t s=seed^(index*0x9e3779b97f4a7c15ULL);
+	return fast_rand64(&s);
+}
+
+const uint64_t LN2_2_POW_64=12786308645202655660ULL;
+
+// Arrival times of a Poisson process at rate lambda are -ln(U1*U2*...*Un)/lambda. The running product
+// is kept normalized with clz like the small lambda loop, as mantissa/2^64 * 2^-exponent, starting at 1.
+
+struct poisson_arrival_state {
+	uint64_t mantissa;
+	int64_t exponent;
+	uint64_t recip;  // 2^127/(lambda<<lambda_shift)
+	uint32_t shift;  // 95-lambda_shift
+};
+
+static inline void poisson_arrival_setup(poisson_arrival_state* s, int64_t lambda) {
+	uint32_t lz=clz64(lambda);
+	s->mantissa=0x8000000000000000ULL;
+	s->exponent=-1;
+	s->recip=divu128by64(0x7FFFFFFFFFFFFFFFULL,0xFFFFFFFFFFFFFFFFULL,((uint64_t)lambda)<<lz);
+	s->shift=95-lz;
+}
+
+static inline void poisson_arrival_step(poisson_arrival_state* s, uint64_t* seed) {
+	uint64_t m=multu64hi(s->mantissa,fast_rand64(seed)|1);
+	uint32_t z=clz64(m);
+	s->mantissa=m<<z;
+	s->exponent+=z;
+}
+
+// ln_mantissa is log_64_fixed(mantissa), so -ln(product)=(exponent+32)*ln(2)-ln_mantissa
+static inline uint64_t poisson_arrival_time(const poisson_arrival_state* s, int64_t exponent, int64_t ln_mantissa) {
+	uint64_t hi,lo;
+	multu64hilo(exponent+32,LN2_2_POW_64,&hi,&lo);
+	uint64_t neg_ln=((hi<<32)|(lo>>32))-ln_mantissa;
+	multu64hilo(neg_ln,s->recip,&hi,&lo);
+	return (s->shift>=64)?(hi>>(s->shift-64)):((hi<<(64-s->shift))|(lo>>s->shift));
+}
+
+// the polynomial part of log_64_fixed for normalized inputs, 4 at a time
+static inline void log_64_fixed_normalized4(const uint64_t* lx, int64_t* ret) {
+	uint32_t d[4];
+#if __x86_64 || _M_X64
+	__m128i x=_mm_sub_epi32(_mm_set_epi32(lx[3]>>32,lx[2]>>32,lx[1]>>32,lx[0]>>32),_mm_set1_epi32(0x80000000U));
+	__m128i x_odd=_mm_srli_epi64(x,32);
+	// (u*x)>>32 on each signed 32 bit lane
+	#define MULTS32HI4(u) _mm_blend_epi16(_mm_srli_epi64(_mm_mul_epi32(u,x),32),_mm_mul_epi32(_mm_srli_epi64(u,32),x_odd),0xCC)
+	__m128i u=_mm_set1_epi32(-19518282);
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(109810370));
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(-291900857));
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(516277066));
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(-744207376));
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(1027494097));
+	u=_mm_add_epi32(MULTS32HI4(_mm_slli_epi32(u,1)),_mm_set1_epi32(-1548619616));
+	u=_mm_add_epi32(MULTS32HI4(u),_mm_set1_epi32(1549074032+93));
+	u=MULTS32HI4(u);
+	#undef MULTS32HI4
+	_mm_storeu_si128((__m128i*)d,u);
+#elif __aarch64__
+	uint64x2_t lo=vld1q_u64(lx);
+	uint64x2_t hi=vld1q_u64(lx+2);
+	int32x4_t x=vreinterpretq_s32_u32(vsubq_u32(vcombine_u32(vshrn_n_u64(lo,32),vshrn_n_u64(hi,32)),vdupq_n_u32(0x80000000U)));
+	// vqdmulhq_s32 is (2*u*x)>>32, which is mults32hi(u<<1,x) as u<<1 never overflows here
+	int32x4_t u=vdupq_n_s32(-19518282);
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(109810370));
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(-291900857));
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(516277066));
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(-744207376));
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(1027494097));
+	u=vaddq_s32(vqdmulhq_s32(u,x),vdupq_n_s32(-1548619616));
+	u=vaddq_s32(vshrq_n_s32(vqdmulhq_s32(u,x),1),vdupq_n_s32(1549074032+93));
+	u=vshrq_n_s32(vqdmulhq_s32(u,x),1);
+	vst1q_u32(d,vreinterpretq_u32_s32(u));
+#else
+	for(uint32_t i=0;i<4;i++) {
+		ret[i]=log_64_fixed(lx[i]);
+	}
+	return;
+#endif
+	for(uint32_t i=0;i<4;i++) {
+		ret[i]=mults64hi(((((uint64_t)d[i])<<3)+(31LL<<32)),6393154322601327829LL)<<1;
+	}
+}
+
+void poisson_random_variate_arrivals(uint64_t* seed, int64_t lambda, uint64_t* times, size_t count) {
+	if(lambda<=0) {
+		for(size_t i=0;i<count;i++) {
+			times[i]=0xFFFFFFFFFFFFFFFFULL;
+		}
+		return;
+	}
+	poisson_arrival_state s;
+	poisson_arrival_setup(&s,lambda);
+	const size_t BLOCK=64;
+	uint64_t mantissa[BLOCK];
+	int64_t exponent[BLOCK];
+	int64_t ln_mantissa[BLOCK];
+	for(size_t i=0;i<count;i+=BLOCK) {
+		size_t n=(count-i<BLOCK)?count-i:BLOCK;
+		// the product is a serial chain, so do it first and then the logs a vector at a time
+		for(size_t j=0;j<n;j++) {
+			poisson_arrival_step(&s,seed);
+			mantissa[j]=s.mantissa;
+			exponent[j]=s.exponent;
+		}
+		size_t j=0;
+		for(;j+4<=n;j+=4) {
+			log_64_fixed_normalized4(mantissa+j,ln_mantissa+j);
+		}
+		for(;j<n;j++) {
+			ln_mantissa[j]=log_64_fixed(mantissa[j]);
+		}
+		for(j=0;j<n;j++) {
+			times[i+j]=poisson_arrival_time(&s,exponent[j],ln_mantissa[j]);
+		}
+	}
+}
+
+uint32_t poisson_random_variate_arrivals_until(uint64_t* seed, int64_t lambda, uint64_t end, uint64_t* times, uint32_t max_count) {
+	if(lambda<=0) {
+		return 0;
+	}
+	poisson_arrival_state s;
+	poisson_arrival_setup(&s,lambda);
+	uint32_t ret=0;
+	while(true) {
+		poisson_arrival_step(&s,seed);
+		uint64_t t=poisson_arrival_time(&s,s.exponent,log_64_fixed(s.mantissa));
+		if(t>=end) {
+			return ret;
+		}
+		if(ret<max_count) {
+			times[ret]=t;
+		}
+		ret++;
+	}
 }
@@ -31,8 +31,106 @@
 #define RANDOM_VARIATE_POISSON_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 // lambda is fixed 32.32
 uint32_t poisson_random_variate_integer(uint64_t* seed, int64_t lambda);
 
+// lambda is fixed 64.64, as lambda_int+lambda_frac/2^64, and lambda_int must be below 2^48
+// larger lambdas are rejected: they return 0xFFFFFFFFFFFFFFFF without using the seed
+// for lambda_int<2^10 this is the same as poisson_random_variate_integer with lambda truncated to 32.32,
+// above that it uses a version of PTRD that stays accurate, so results differ from poisson_random_variate_integer
+uint64_t poisson_random_variate_integer_64(uint64_t* seed, uint64_t lambda_int, uint64_t lambda_frac);
+
+// same as calling poisson_random_variate_integer count times, with the per-lambda setup done once
+void poisson_random_variate_integer_fill(uint64_t* seed, int64_t lambda, uint32_t* out, size_t count);
+
+// Approximate mode for large lambda: when lambda>=threshold (both fixed 32.32) a continuity corrected normal
+// approximation with a skewness term is used, with a total variation distance from Poisson of about 0.023/lambda
+// (2.3e-8 for lambda=10^6). It uses exactly one random word per variate. Below threshold it is exact.
+uint32_t poisson_random_variate_integer_approx(uint64_t* seed, int64_t lambda, int64_t threshold);
+void poisson_random_variate_integer_approx_fill(uint64_t* seed, int64_t lambda, int64_t threshold, uint32_t* out, size_t count);
+
+// Negative binomial (gamma mixed Poisson) with the given mean and shape (both fixed 32.32, shape>0), so the
+// variance is mean+mean^2/shape. Only integer operations are used. Results saturate at 0xFFFFFFFF. Shapes below
+// 2^-16 are treated as 2^-16. The fill version does the setup for mean and shape once.
+uint32_t poisson_random_variate_negative_binomial(uint64_t* seed, int64_t mean, int64_t shape);
+void poisson_random_variate_negative_binomial_fill(uint64_t* seed, int64_t mean, int64_t shape, uint32_t* out, size_t count);
+
+// Histogram of draws variates with the same lambda (fixed 32.32): hist[k] is set to the number equal to k, except
+// hist[hist_size-1] which counts everything >=hist_size-1. The bins are drawn as Poisson variates, and then about
+// 3*sqrt(draws) single variates are added one at a time, so the cost grows with the width of the distribution and
+// sqrt(draws), rather than with draws. Returns 0 on success, -1 (with hist unchanged) if hist_size is 0 or draws>=2^48.
+int poisson_random_variate_integer_histogram(uint64_t* seed, int64_t lambda, uint64_t draws, uint64_t* hist, uint32_t hist_size);
+
+// Tuned mode, with the crossovers between the scalar loop, the SIMD loop and PTRD measured on this machine.
+// The regimes give different results for the same seed, so results are NOT reproducible across machines or
+// calibrations (except with the default thresholds, which give exactly poisson_random_variate_integer).
+typedef struct poisson_random_variate_thresholds {
+	int64_t small_max; // fixed 32.32, the scalar loop is used up to here
+	int64_t mid_max;   // fixed 32.32, then the SIMD loop up to here, then PTRD
+} poisson_random_variate_thresholds;
+// thresholds out of range are clamped when used: both to at most 64, and mid_max to at least 10 and small_max
+
+void poisson_random_variate_thresholds_default(poisson_random_variate_thresholds* t);
+// times the regimes at lambda=1..64, which takes up to about 100 milliseconds
+void poisson_random_variate_thresholds_calibrate(poisson_random_variate_thresholds* t);
+// a small text file, returns 0 on success, -1 on failure
+int poisson_random_variate_thresholds_save(const poisson_random_variate_thresholds* t, const char* path);
+int poisson_random_variate_thresholds_load(poisson_random_variate_thresholds* t, const char* path);
+
+uint32_t poisson_random_variate_integer_tuned(uint64_t* seed, int64_t lambda, const poisson_random_variate_thresholds* t);
+void poisson_random_variate_integer_tuned_fill(uint64_t* seed, int64_t lambda, const poisson_random_variate_thresholds* t, uint32_t* out, size_t count);
+
+// Bounded latency mode: an alias table for one lambda (fixed 32.32) gives a variate from exactly one random word.
+// poisson_random_variate_integer_bounded uses only the table for lambda<=38. Above that it tries PTRD at most
+// max_trials times (each uses 1 or 2 random words) and then uses the table. This doesn't change the distribution,
+// and for lambda>38 the results are the same as poisson_random_variate_integer except when the trials run out.
+// The table has up to about 40*sqrt(lambda) 16 byte entries.
+typedef struct poisson_random_variate_table poisson_random_variate_table;
+
+poisson_random_variate_table* poisson_random_variate_table_create(int64_t lambda);
+void poisson_random_variate_table_destroy(poisson_random_variate_table* table);
+uint32_t poisson_random_variate_table_sample(uint64_t* seed, const poisson_random_variate_table* table);
+
+uint32_t poisson_random_variate_integer_bounded(uint64_t* seed, const poisson_random_variate_table* table, uint32_t max_trials);
+void poisson_random_variate_integer_bounded_fill(uint64_t* seed, const poisson_random_variate_table* table, uint32_t max_trials, uint32_t* out, size_t count);
+
+// Fixed consumption mode: every variate uses exactly words random words (0 is treated as 1), with any left over skipped, so
+// the seed after n variates is known without generating them. It is the bounded mode with max_trials=(words-1)/2.
+// poisson_random_variate_skip moves a seed on by count variates in one step, so a stream can be split between
+// threads, each starting from a skipped copy of the seed, and still give exactly the same values.
+uint32_t poisson_random_variate_integer_fixed(uint64_t* seed, const poisson_random_variate_table* table, uint32_t words);
+void poisson_random_variate_integer_fixed_fill(uint64_t* seed, const poisson_random_variate_table* table, uint32_t words, uint32_t* out, size_t count);
+void poisson_random_variate_skip(uint64_t* seed, uint64_t count, uint32_t words);
+
+// many independent streams at once: out[i]=poisson_random_variate_integer(&seeds[i],lambdas[i]) for every i
+void poisson_random_variate_integer_streams(uint64_t* seeds, const int64_t* lambdas, uint32_t* out, size_t count);
+
+// streams for seeds, lambdas and results that are fields of arrays of structs, used in place: item i's seed, lambda
+// and result are at byte offsets i*seed_stride, i*lambda_stride and i*out_stride from seeds, lambdas and out, and
+// must be aligned. The results are the same as poisson_random_variate_integer_streams. With seed_stride 0 every item
+// uses the one seed in turn, as calls to poisson_random_variate_integer would.
+// The double version converts each lambda to fixed 32.32 once (lambda<=0 and NaN give 0, and lambda>=2^31, which
+// doesn't fit, gives the largest 32.32 value, as if INT64_MAX had been passed to the fixed version).
+void poisson_random_variate_integer_streams_strided(uint64_t* seeds, size_t seed_stride, const int64_t* lambdas, size_t lambda_stride, uint32_t* out, size_t out_stride, size_t count);
+void poisson_random_variate_integer_streams_strided_double(uint64_t* seeds, size_t seed_stride, const double* lambdas, size_t lambda_stride, uint32_t* out, size_t out_stride, size_t count);
+
+// narrow versions of poisson_random_variate_integer_fill for small lambdas (below about 100 for 8 bits)
+// values that don't fit are saturated to 0xFFFF/0xFF, and the number of saturated values is returned
+size_t poisson_random_variate_integer_fill_u16(uint64_t* seed, int64_t lambda, uint16_t* out, size_t count);
+size_t poisson_random_variate_integer_fill_u8(uint64_t* seed, int64_t lambda, uint8_t* out, size_t count);
+
+// Arrival times of a Poisson process with rate lambda (fixed 32.32), as fixed 32.32 times from 0, using one
+// random word per arrival. Times must stay below 2^32.
+void poisson_random_variate_arrivals(uint64_t* seed, int64_t lambda, uint64_t* times, size_t count);
+
+// Arrivals in [0,end) (end is fixed 32.32). The first max_count are stored, and the total number is returned.
+// This count is Poisson with mean lambda*end, and for lambda*end<=18 it uses the same random words as
+// poisson_random_variate_integer(seed,lambda*end), so it gives the same count apart from rare rounding differences.
+uint32_t poisson_random_variate_arrivals_until(uint64_t* seed, int64_t lambda, uint64_t end, uint64_t* times, uint32_t max_count);
+
+// a seed for an independent stream, e.g. one per lambda, chunk or tile
+uint64_t poisson_random_variate_derive_seed(uint64_t seed, uint64_t index);
+
 #endif // RANDOM_VARIATE_POISSON_H
@@ -27,7 +27,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "RandomVariatePoisson.h"
+#include "poisson_random_variate_old.h"
 #if __x86_64 || _M_X64
 #include <emmintrin.h>
 #include <smmintrin.h>
@@ -149,39 +149,57 @@ static inline uint64_t horizonal_mult16_8_corr(uint8x16_t x) {
 	return (multu64hi(startx0,startx1)>>8)*(256+36);
 }
 
-// lambda is fixed 32.32
-uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda) {
+// lambda<=0 gives int_digits<0, which legacy_sample returns as 0
+static inline void legacy_setup(int64_t lambda, int32_t* int_digits, uint32_t* r15) {
 	if(lambda<=0) {
-		return 0;
+		*int_digits=-1;
+		*r15=0;
+		return;
 	}
 	lambda=multu64hi(9224486805748300000ULL,(lambda<<1));
 	uint64_t num_digits=multu64hi(lambda,P_LN2_INV_2_POW_63)<<1;
-	int32_t int_digits=num_digits>>32;
+	*int_digits=num_digits>>32;
 	num_digits&=0xFFFFFFFFULL;
-	uint32_t r15=p_exp2_32_internal((uint32_t)num_digits)>>23; // e^(ln(2)*x) = (e^ln(2))^x = 2^x
+	*r15=p_exp2_32_internal((uint32_t)num_digits)>>23; // e^(ln(2)*x) = (e^ln(2))^x = 2^x
+}
+
+static inline uint32_t legacy_small(uint64_t* seed, int32_t int_digits, uint32_t r15) {
 	int32_t ret=-1;
-	if (int_digits<18) {
-		uint8_t start=r15;
-		uint32_t i=8;
-		uint64_t r=0;
-		while(int_digits>=0) {
-			if(i==8) {
-				r=fast_rand64(seed);
-				i=0;
-			}
-			start=max((((uint32_t)start)*(((uint32_t)r)&0xFF)+0xA7)>>8,1U);
-			uint32_t z=clz32(start)-24;
-			int_digits-=z;
-			start<<=z;
-			ret++;
-			i++;
-			r>>=8;
+	uint8_t start=r15;
+	uint32_t i=8;
+	uint64_t r=0;
+	while(int_digits>=0) {
+		if(i==8) {
+			r=fast_rand64(seed);
+			i=0;
 		}
-		return ret;
+		start=max((((uint32_t)start)*(((uint32_t)r)&0xFF)+0xA7)>>8,1U);
+		uint32_t z=clz32(start)-24;
+		int_digits-=z;
+		start<<=z;
+		ret++;
+		i++;
+		r>>=8;
 	}
-	uint8_t old_start_flag=r15;
-	int32_t old_int_digits=int_digits;
+	return ret;
+}
+
+// the last two blocks of 16 products, to work out exactly where the product dropped below e^-lambda
+struct legacy_history {
+	uint8x16_t old_start;
+	uint8x16_t old_old_start;
+	uint8x16_t old_rand;
+	uint8x16_t old_old_rand;
+	uint8_t old_start_flag;
+	uint8_t old_old_start_flag;
+	int32_t old_int_digits;
+	int32_t old_old_int_digits;
+};
+
 #if __x86_64 || _M_X64
+
+// make the top bit of every byte set, and return the total shift
+static inline __m128i legacy_normalize(__m128i startx, uint32_t* t) {
 	__m128i zero=_mm_setzero_si128();
 	__m128i const_1=_mm_set1_epi8(1);
 	__m128i const_F0=_mm_set1_epi8(0xF0U);
@@ -189,12 +207,6 @@ uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda) {
 	__m128i const_80=_mm_set1_epi8(0x80U);
 	__m128i const_FC=_mm_set1_epi8(0xFCU);
 	__m128i const_FE=_mm_set1_epi8(0xFEU);
-	__m128i const_A7=_mm_set1_epi16(0xA7U);
-	__m128i old_start=_mm_insert_epi8(_mm_set1_epi8(0xFFU),r15,0);
-	uint64_t a=fast_rand64(seed);
-	uint64_t b=fast_rand64(seed);
-	__m128i old_rand=_mm_set_epi64x(b,a);
-	__m128i startx=_mm_insert_epi8(old_rand,(((uint32_t)((uint8_t)_mm_extract_epi8(old_rand,0)))*r15+0xA7)>>8,0);
 	startx=_mm_max_epu8(startx,const_1);
 	__m128i clz_select4=_mm_cmpeq_epi8(_mm_and_si128(startx,const_F0),zero);
 	startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,4),const_F0),clz_select4);
@@ -202,119 +214,148 @@ uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda) {
 	startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,2),const_FC),clz_select2);
 	__m128i clz_select1=_mm_cmpeq_epi8(_mm_and_si128(startx,const_80),zero);
 	startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,1),const_FE),clz_select1);
-	uint32_t t=__builtin_popcount(_mm_movemask_epi8(clz_select4));
-	t=__builtin_popcount(_mm_movemask_epi8(clz_select2))+t+t;
-	t=__builtin_popcount(_mm_movemask_epi8(clz_select1))+t+t;
-	int_digits-=t;
+	// sum the shifts with psadbw, popcount is a library call without -mpopcnt
+	__m128i shifts=_mm_or_si128(_mm_or_si128(_mm_and_si128(clz_select4,_mm_set1_epi8(4)),_mm_and_si128(clz_select2,_mm_set1_epi8(2))),_mm_and_si128(clz_select1,const_1));
+	__m128i sum=_mm_sad_epu8(shifts,zero);
+	*t=_mm_cvtsi128_si32(sum)+_mm_extract_epi16(sum,4);
+	return startx;
+}
+
+static inline __m128i legacy_mult(__m128i startx, __m128i x) {
+	__m128i zero=_mm_setzero_si128();
+	__m128i const_A7=_mm_set1_epi16(0xA7U);
+	__m128i start_lo=_mm_unpacklo_epi8(startx,zero);
+	__m128i start_hi=_mm_unpackhi_epi8(startx,zero);
+	__m128i x_lo=_mm_unpacklo_epi8(x,zero);
+	__m128i x_hi=_mm_unpackhi_epi8(x,zero);
+	start_lo=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(start_lo,x_lo),const_A7),8);
+	start_hi=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(start_hi,x_hi),const_A7),8);
+	return _mm_packus_epi16(start_lo,start_hi);
+}
+
+static inline __m128i legacy_start(uint64_t* seed, uint32_t r15, int32_t* int_digits, legacy_history* h) {
+	h->old_start=_mm_insert_epi8(_mm_set1_epi8(0xFFU),r15,0);
+	uint64_t a=fast_rand64(seed);
+	uint64_t b=fast_rand64(seed);
+	h->old_rand=_mm_set_epi64x(b,a);
+	__m128i startx=_mm_insert_epi8(h->old_rand,(((uint32_t)((uint8_t)_mm_extract_epi8(h->old_rand,0)))*r15+0xA7)>>8,0);
+	uint32_t t;
+	startx=legacy_normalize(startx,&t);
+	*int_digits-=t;
+	return startx;
+}
+
+static inline __m128i legacy_block(uint64_t* seed, __m128i startx, uint8x16_t* rand, int32_t* int_digits) {
+	uint64_t a=fast_rand64(seed);
+	uint64_t b=fast_rand64(seed);
+	*rand=_mm_set_epi64x(b,a);
+	uint32_t t;
+	startx=legacy_normalize(legacy_mult(startx,*rand),&t);
+	*int_digits-=t;
+	return startx;
+}
+
 #elif __aarch64__
-	uint16x8_t const_a7=vdupq_n_u16(0xA7);
+
+static inline uint8x16_t legacy_start(uint64_t* seed, uint32_t r15, int32_t* int_digits, legacy_history* h) {
 	uint8x16_t const_1=vdupq_n_u8(1);
-	uint8x16_t old_start=vsetq_lane_u8(r15,vdupq_n_u8(0xFF),0);
+	h->old_start=vsetq_lane_u8(r15,vdupq_n_u8(0xFF),0);
 	uint64_t a=fast_rand64(seed);
 	uint64_t b=fast_rand64(seed);
-	uint8x16_t old_rand=vcombine_u8(vcreate_u8(a),vcreate_u8(b));
-	uint8x16_t startx=vsetq_lane_u8((((uint32_t)((uint8_t)vgetq_lane_u8(old_rand,0)))*r15+0xA7)>>8,old_rand,0);
+	h->old_rand=vcombine_u8(vcreate_u8(a),vcreate_u8(b));
+	uint8x16_t startx=vsetq_lane_u8((((uint32_t)((uint8_t)vgetq_lane_u8(h->old_rand,0)))*r15+0xA7)>>8,h->old_rand,0);
 	startx=vmaxq_u8(startx,const_1);
 	uint8x16_t zz=vclzq_u8(startx);
 	startx=vshlq_u8(startx,vreinterpretq_s8_u8(zz));
-	int_digits-=vaddvq_u8(zz);
+	*int_digits-=vaddvq_u8(zz);
+	return startx;
+}
+
+static inline uint8x16_t legacy_block(uint64_t* seed, uint8x16_t startx, uint8x16_t* rand, int32_t* int_digits) {
+	uint16x8_t const_a7=vdupq_n_u16(0xA7);
+	uint8x16_t const_1=vdupq_n_u8(1);
+	uint64_t a=fast_rand64(seed);
+	uint64_t b=fast_rand64(seed);
+	*rand=vcombine_u8(vcreate_u8(a),vcreate_u8(b));
+	uint16x8_t mul_lo=vmull_u8(vget_low_u8(startx),vget_low_u8(*rand));
+	uint16x8_t mul_hi=vmull_high_u8(startx,*rand);
+	startx=vcombine_u8(vshrn_n_u16(vaddq_u16(mul_lo,const_a7),8),vshrn_n_u16(vaddq_u16(mul_hi,const_a7),8));
+	uint8x16_t mult=vmaxq_u8(startx,const_1);
+	uint8x16_t z=vclzq_u8(mult);
+	startx=vshlq_u8(mult,vreinterpretq_s8_u8(z));
+	*int_digits-=vaddvq_u8(z);
+	return startx;
+}
+
 #else // don't know what the processor is
-	variant startx,old_start,old_rand;
-	old_rand.s64[0]=(fast_rand64(seed));
-	old_rand.s64[1]=(fast_rand64(seed));
-	startx=old_rand;
-	startx.s8[15]=max((((uint32_t)old_rand.s8[15])*r15+0xA7)>>8,1U);
+
+static inline variant legacy_start(uint64_t* seed, uint32_t r15, int32_t* int_digits, legacy_history* h) {
+	h->old_rand.s64[0]=(fast_rand64(seed));
+	h->old_rand.s64[1]=(fast_rand64(seed));
+	variant startx=h->old_rand;
+	startx.s8[15]=max((((uint32_t)h->old_rand.s8[15])*r15+0xA7)>>8,1U);
 	for(uint32_t i=0;i<16;i++) {
-		old_start.s8[i]=0xFF;
+		h->old_start.s8[i]=0xFF;
 		uint8_t x=max(startx.s8[i],(uint8_t)1);
 		int32_t z=clz32(x)-24;
-		int_digits-=z;
+		*int_digits-=z;
 		x<<=z;
 		startx.s8[i]=x;
 	}
-	old_start.s8[15]=r15;
-#endif
-	ret += 16;
-	uint8x16_t old_old_start=old_start;
-	uint8_t old_old_start_flag=old_start_flag;
-	int32_t old_old_int_digits=old_int_digits;
-	uint8x16_t old_old_rand=old_rand;
-	while (int_digits >= 0) {
-		old_old_start=old_start;
-		old_old_start_flag=old_start_flag;
-		old_old_int_digits=old_int_digits;
-		old_old_rand=old_rand;
-		old_start=startx;
-		old_start_flag=0;
-		old_int_digits=int_digits;
-#if __x86_64 || _M_X64
-		uint64_t a=fast_rand64(seed);
-		uint64_t b=fast_rand64(seed);
-		old_rand=_mm_set_epi64x(b,a);
-		__m128i start_lo=_mm_unpacklo_epi8(startx,zero);
-		__m128i start_hi=_mm_unpackhi_epi8(startx,zero);
-		__m128i x_lo=_mm_unpacklo_epi8(old_rand,zero);
-		__m128i x_hi=_mm_unpackhi_epi8(old_rand,zero);
-		start_lo=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(start_lo,x_lo),const_A7),8);
-		start_hi=_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(start_hi,x_hi),const_A7),8);
-		startx=_mm_packus_epi16(start_lo,start_hi);
-		startx=_mm_max_epu8(startx,const_1);
-		__m128i clz_select4=_mm_cmpeq_epi8(_mm_and_si128(startx,const_F0),zero);
-		startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,4),const_F0),clz_select4);
-		__m128i clz_select2=_mm_cmpeq_epi8(_mm_and_si128(startx,const_C0),zero);
-		startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,2),const_FC),clz_select2);
-		__m128i clz_select1=_mm_cmpeq_epi8(_mm_and_si128(startx,const_80),zero);
-		startx=_mm_blendv_epi8(startx,_mm_and_si128(_mm_slli_epi64(startx,1),const_FE),clz_select1);
-		uint32_t t=__builtin_popcount(_mm_movemask_epi8(clz_select4));
-		t=__builtin_popcount(_mm_movemask_epi8(clz_select2))+t+t;
-		t=__builtin_popcount(_mm_movemask_epi8(clz_select1))+t+t;
-		int_digits-=t;
-#elif __aarch64__
-		uint64_t a=fast_rand64(seed);
-		uint64_t b=fast_rand64(seed);
-		old_rand=vcombine_u8(vcreate_u8(a),vcreate_u8(b));
-		uint16x8_t mul_lo=vmull_u8(vget_low_u8(startx),vget_low_u8(old_rand));
-		uint16x8_t mul_hi=vmull_high_u8(startx,old_rand);
-		startx=vcombine_u8(vshrn_n_u16(vaddq_u16(mul_lo,const_a7),8),vshrn_n_u16(vaddq_u16(mul_hi,const_a7),8));
-		uint8x16_t mult=vmaxq_u8(startx,const_1);
-		uint8x16_t z=vclzq_u8(mult);
-		startx=vshlq_u8(mult,vreinterpretq_s8_u8(z));
-		int_digits-=vaddvq_u8(z);
-#else // don't know what the processor is
-		old_rand.s64[0]=(fast_rand64(seed));
-		old_rand.s64[1]=(fast_rand64(seed));
-		for(uint32_t i=0;i<16;i++) {
-			uint32_t x=startx.s8[i];
-			x=max((x*old_rand.s8[i]+0xA7)>>8,1U);
-			int32_t z=clz32(x)-24;
-			int_digits-=z;
-			x<<=z;
-			startx.s8[i]=x;
-		}
-#endif
-		ret+=16;
+	h->old_start.s8[15]=r15;
+	return startx;
+}
+
+static inline variant legacy_block(uint64_t* seed, variant startx, variant* rand, int32_t* int_digits) {
+	rand->s64[0]=(fast_rand64(seed));
+	rand->s64[1]=(fast_rand64(seed));
+	for(uint32_t i=0;i<16;i++) {
+		uint32_t x=startx.s8[i];
+		x=max((x*rand->s8[i]+0xA7)>>8,1U);
+		int32_t z=clz32(x)-24;
+		*int_digits-=z;
+		x<<=z;
+		startx.s8[i]=x;
 	}
+	return startx;
+}
+
+#endif
+
+static inline void legacy_history_shift(legacy_history* h, uint8x16_t startx, int32_t int_digits) {
+	h->old_old_start=h->old_start;
+	h->old_old_start_flag=h->old_start_flag;
+	h->old_old_int_digits=h->old_int_digits;
+	h->old_old_rand=h->old_rand;
+	h->old_start=startx;
+	h->old_start_flag=0;
+	h->old_int_digits=int_digits;
+}
+
+static inline uint32_t legacy_finish(int32_t ret, const legacy_history* h) {
 	union variant urand;
 	ret-=16;
-	uint64_t start64=horizonal_mult16_8_corr(old_start);
+	uint8_t old_start_flag=h->old_start_flag;
+	int32_t int_digits;
+	uint64_t start64=horizonal_mult16_8_corr(h->old_start);
 	int32_t z=clz64(start64);
-	if(old_start_flag==0 && old_int_digits<z) {
+	if(old_start_flag==0 && h->old_int_digits<z) {
 		ret-=16;
-		int_digits=old_old_int_digits;
+		int_digits=h->old_old_int_digits;
 #if __x86_64 || _M_X64 || __aarch64__
-		urand.v=old_old_rand;
+		urand.v=h->old_old_rand;
 #else
-		urand=old_old_rand;
+		urand=h->old_old_rand;
 #endif
-		old_start_flag=old_old_start_flag;
-		start64=horizonal_mult16_8_corr(old_old_start);
+		old_start_flag=h->old_old_start_flag;
+		start64=horizonal_mult16_8_corr(h->old_old_start);
 		z=clz64(start64);
 	} else {
-		int_digits=old_int_digits;
+		int_digits=h->old_int_digits;
 #if __x86_64 || _M_X64 || __aarch64__
-		urand.v=old_rand;
+		urand.v=h->old_rand;
 #else
-		urand=old_rand;
+		urand=h->old_rand;
 #endif
 	}
 	uint8_t start;
@@ -334,3 +375,62 @@ uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda) {
 	}
 	return ret;
 }
+
+// the 16 lane loop, from the state after the first block
+// the seed is kept in a local, as the vector stores to h could alias it
+static inline uint32_t legacy_run(uint64_t* seed, uint8x16_t startx, int32_t int_digits, int32_t ret, legacy_history* h) {
+	uint64_t s=*seed;
+	while(int_digits>=0) {
+		legacy_history_shift(h,startx,int_digits);
+		startx=legacy_block(&s,startx,&h->old_rand,&int_digits);
+		ret+=16;
+	}
+	*seed=s;
+	return legacy_finish(ret,h);
+}
+
+static inline uint8x16_t legacy_first(uint64_t* seed, uint32_t r15, int32_t* int_digits, legacy_history* h) {
+	h->old_start_flag=r15;
+	h->old_int_digits=*int_digits;
+	uint8x16_t startx=legacy_start(seed,r15,int_digits,h);
+	h->old_old_start=h->old_start;
+	h->old_old_start_flag=h->old_start_flag;
+	h->old_old_int_digits=h->old_int_digits;
+	h->old_old_rand=h->old_rand;
+	return startx;
+}
+
+static inline uint32_t legacy_sample(uint64_t* seed, int32_t int_digits, uint32_t r15) {
+	if(int_digits<0) {
+		return 0;
+	}
+	if(int_digits<18) {
+		return legacy_small(seed,int_digits,r15);
+	}
+	legacy_history h;
+	uint8x16_t startx=legacy_first(seed,r15,&int_digits,&h);
+	return legacy_run(seed,startx,int_digits,15,&h);
+}
+
+// lambda is fixed 32.32
+uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda) {
+	int32_t int_digits;
+	uint32_t r15;
+	legacy_setup(lambda,&int_digits,&r15);
+	return legacy_sample(seed,int_digits,r15);
+}
+
+void poisson_random_variable_fixed_int_fill(uint64_t* seed, int64_t lambda, uint32_t* out, size_t count) {
+	int32_t int_digits;
+	uint32_t r15;
+	legacy_setup(lambda,&int_digits,&r15);
+	for(size_t i=0;i<count;i++) {
+		out[i]=legacy_sample(seed,int_digits,r15);
+	}
+}
+
+void poisson_random_variable_fixed_int_streams(uint64_t* seeds, const int64_t* lambdas, uint32_t* out, size_t count) {
+	for(size_t i=0;i<count;i++) {
+		out[i]=poisson_random_variable_fixed_int(&seeds[i],lambdas[i]);
+	}
+}
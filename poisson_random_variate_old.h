@@ -0,0 +1,47 @@
+// BSD 3-Clause License
+// 
+// Copyright (c) 2023, Roy Ward
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RANDOM_VARIATE_POISSON_OLD_H
+#define RANDOM_VARIATE_POISSON_OLD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The 1.0.0 generator, kept for reproducing existing results. Use poisson_random_variate_integer.h for anything new.
+
+// lambda is fixed 32.32
+uint32_t poisson_random_variable_fixed_int(uint64_t* seed, int64_t lambda);
+
+// same as calling poisson_random_variable_fixed_int count times, with the per-lambda setup done once
+void poisson_random_variable_fixed_int_fill(uint64_t* seed, int64_t lambda, uint32_t* out, size_t count);
+
+// out[i]=poisson_random_variable_fixed_int(&seeds[i],lambdas[i]) for every i
+void poisson_random_variable_fixed_int_streams(uint64_t* seeds, const int64_t* lambdas, uint32_t* out, size_t count);
+
+#endif // RANDOM_VARIATE_POISSON_OLD_H
@@ -0,0 +1,204 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "poisson_random_variate_tiles.h"
+#include "poisson_random_variate_integer.h"
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+struct poisson_tile_key {
+	int64_t x;
+	int64_t y;
+	bool operator==(const poisson_tile_key& other) const {
+		return x==other.x && y==other.y;
+	}
+};
+
+struct poisson_tile_hash {
+	size_t operator()(const poisson_tile_key& key) const {
+		return (size_t)poisson_random_variate_derive_seed((uint64_t)key.x,(uint64_t)key.y);
+	}
+};
+
+// a tile is either hot (counts filled in) or cold (packed filled in), and is in the matching lru list
+struct poisson_tile {
+	std::vector<uint32_t> counts;
+	std::vector<uint8_t> packed;
+	std::list<poisson_tile_key>::iterator lru;
+	bool hot;
+};
+
+struct poisson_random_variate_tiles {
+	poisson_random_variate_tiles_config config;
+	uint64_t cells;
+	std::unordered_map<poisson_tile_key,poisson_tile,poisson_tile_hash> map;
+	std::list<poisson_tile_key> hot;  // most recently used first
+	std::list<poisson_tile_key> cold; // most recently compressed first
+	std::vector<int64_t> lambdas;
+	uint64_t cold_used;
+	uint64_t hits;
+	uint64_t cold_hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+static void poisson_tile_generate(poisson_random_variate_tiles* t, const poisson_tile_key& key, uint32_t* out) {
+	uint64_t seed=poisson_random_variate_derive_seed(poisson_random_variate_derive_seed(t->config.seed,(uint64_t)key.x),(uint64_t)key.y);
+	if(!t->config.lambda_fn) {
+		poisson_random_variate_integer_fill(&seed,t->config.lambda,out,t->cells);
+		return;
+	}
+	t->config.lambda_fn(t->config.context,key.x,key.y,t->lambdas.data());
+	for(uint64_t i=0;i<t->cells;i++) {
+		out[i]=poisson_random_variate_integer(&seed,t->lambdas[i]);
+	}
+}
+
+// 7 bits per byte, high bit set on all but the last byte of a count
+static void poisson_tile_pack(const std::vector<uint32_t>& counts, std::vector<uint8_t>& packed) {
+	packed.clear();
+	for(uint32_t c : counts) {
+		while(c>=0x80) {
+			packed.push_back((uint8_t)(c|0x80));
+			c>>=7;
+		}
+		packed.push_back((uint8_t)c);
+	}
+	packed.shrink_to_fit();
+}
+
+static void poisson_tile_unpack(const std::vector<uint8_t>& packed, uint32_t* out) {
+	const uint8_t* p=packed.data();
+	const uint8_t* end=p+packed.size();
+	while(p<end) {
+		uint32_t c=0;
+		uint32_t shift=0;
+		while(*p&0x80) {
+			c|=(uint32_t)(*p++&0x7f)<<shift;
+			shift+=7;
+		}
+		*out++=c|((uint32_t)*p++<<shift);
+	}
+}
+
+static void poisson_tiles_trim_cold(poisson_random_variate_tiles* t) {
+	while(t->cold_used>t->config.cold_bytes) {
+		auto it=t->map.find(t->cold.back());
+		t->cold_used-=it->second.packed.size();
+		t->cold.pop_back();
+		t->map.erase(it);
+		t->evictions++;
+	}
+}
+
+// pushes the least recently used hot tile out, and returns its counts buffer for reuse
+static std::vector<uint32_t> poisson_tiles_evict_hot(poisson_random_variate_tiles* t) {
+	auto it=t->map.find(t->hot.back());
+	t->hot.pop_back();
+	std::vector<uint32_t> counts=std::move(it->second.counts);
+	if(t->config.cold_bytes==0) {
+		t->map.erase(it);
+		t->evictions++;
+		return counts;
+	}
+	poisson_tile_pack(counts,it->second.packed);
+	it->second.hot=false;
+	t->cold.push_front(it->first);
+	it->second.lru=t->cold.begin();
+	t->cold_used+=it->second.packed.size();
+	poisson_tiles_trim_cold(t);
+	return counts;
+}
+
+poisson_random_variate_tiles* poisson_random_variate_tiles_create(const poisson_random_variate_tiles_config* config) {
+	poisson_random_variate_tiles* t=new poisson_random_variate_tiles;
+	t->config=*config;
+	if(t->config.max_tiles==0) {
+		t->config.max_tiles=1;
+	}
+	t->cells=(uint64_t)config->width*config->height;
+	if(config->lambda_fn) {
+		t->lambdas.resize(t->cells);
+	}
+	t->cold_used=0;
+	t->hits=0;
+	t->cold_hits=0;
+	t->misses=0;
+	t->evictions=0;
+	return t;
+}
+
+void poisson_random_variate_tiles_destroy(poisson_random_variate_tiles* t) {
+	delete t;
+}
+
+const uint32_t* poisson_random_variate_tiles_get(poisson_random_variate_tiles* t, int64_t x, int64_t y) {
+	poisson_tile_key key={x,y};
+	auto it=t->map.find(key);
+	if(it!=t->map.end() && it->second.hot) {
+		t->hits++;
+		t->hot.splice(t->hot.begin(),t->hot,it->second.lru);
+		return it->second.counts.data();
+	}
+	std::vector<uint32_t> counts;
+	if(t->hot.size()>=t->config.max_tiles) {
+		counts=poisson_tiles_evict_hot(t);
+		// the eviction may have dropped this very tile from the cold list
+		it=t->map.find(key);
+	}
+	counts.resize(t->cells);
+	if(it!=t->map.end()) {
+		t->cold_hits++;
+		poisson_tile_unpack(it->second.packed,counts.data());
+		t->cold_used-=it->second.packed.size();
+		t->cold.erase(it->second.lru);
+		it->second.packed=std::vector<uint8_t>();
+	} else {
+		t->misses++;
+		poisson_tile_generate(t,key,counts.data());
+		it=t->map.emplace(key,poisson_tile()).first;
+	}
+	it->second.counts=std::move(counts);
+	it->second.hot=true;
+	t->hot.push_front(key);
+	it->second.lru=t->hot.begin();
+	return it->second.counts.data();
+}
+
+void poisson_random_variate_tiles_get_stats(const poisson_random_variate_tiles* t, poisson_random_variate_tiles_stats* stats) {
+	stats->hits=t->hits;
+	stats->cold_hits=t->cold_hits;
+	stats->misses=t->misses;
+	stats->evictions=t->evictions;
+	stats->tiles=(uint32_t)t->hot.size();
+	stats->cold_tiles=(uint32_t)t->cold.size();
+	stats->cold_used=t->cold_used;
+}
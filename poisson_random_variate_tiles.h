@@ -0,0 +1,78 @@
+// BSD 3-Clause License
+// 
+// Copyright (c) 2023, Roy Ward
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef POISSON_RANDOM_VARIATE_TILES_H
+#define POISSON_RANDOM_VARIATE_TILES_H
+
+#include <stdint.h>
+
+// Cache of tiles of counts keyed by tile coordinates, for callers that revisit the same tiles.
+// Tile (x,y) uses the seed poisson_random_variate_derive_seed(poisson_random_variate_derive_seed(seed,x),y),
+// so a tile that has been dropped is regenerated with identical counts on its next visit.
+// The max_tiles most recently used tiles are kept as they are. If cold_bytes is not 0, tiles pushed out of
+// that set are varint compressed and kept, least recently used first out, until they exceed cold_bytes.
+// Not thread safe.
+
+// fills lambdas[0..width*height) with the fixed 32.32 lambdas of tile (x,y), row by row
+typedef void (*poisson_random_variate_tiles_lambda_fn)(void* context, int64_t x, int64_t y, int64_t* lambdas);
+
+typedef struct poisson_random_variate_tiles poisson_random_variate_tiles;
+
+typedef struct poisson_random_variate_tiles_config {
+	uint64_t seed;
+	int64_t lambda;                                   // fixed 32.32, used for every cell if lambda_fn is NULL
+	poisson_random_variate_tiles_lambda_fn lambda_fn; // optional per cell lambdas
+	void* context;                                    // passed to lambda_fn
+	uint32_t width;                                   // cells per tile row
+	uint32_t height;                                  // rows per tile
+	uint32_t max_tiles;                               // uncompressed tiles kept, at least 1
+	uint64_t cold_bytes;                              // budget for compressed tiles, 0 to drop tiles instead
+} poisson_random_variate_tiles_config;
+
+typedef struct poisson_random_variate_tiles_stats {
+	uint64_t hits;        // tile was kept uncompressed
+	uint64_t cold_hits;   // tile was decompressed
+	uint64_t misses;      // tile was generated
+	uint64_t evictions;   // tiles dropped altogether
+	uint32_t tiles;       // uncompressed tiles currently kept
+	uint32_t cold_tiles;  // compressed tiles currently kept
+	uint64_t cold_used;   // bytes used by the compressed tiles
+} poisson_random_variate_tiles_stats;
+
+poisson_random_variate_tiles* poisson_random_variate_tiles_create(const poisson_random_variate_tiles_config* config);
+
+void poisson_random_variate_tiles_destroy(poisson_random_variate_tiles* tiles);
+
+// returns the width*height counts of tile (x,y), row by row
+// the pointer stays valid until max_tiles other tiles have been got, or the cache is destroyed
+const uint32_t* poisson_random_variate_tiles_get(poisson_random_variate_tiles* tiles, int64_t x, int64_t y);
+
+void poisson_random_variate_tiles_get_stats(const poisson_random_variate_tiles* tiles, poisson_random_variate_tiles_stats* stats);
+
+#endif // POISSON_RANDOM_VARIATE_TILES_H
@@ -0,0 +1,107 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Roy Ward
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef POISSON_RANDOM_VARIATE_VIEW_H
+#define POISSON_RANDOM_VARIATE_VIEW_H
+
+// C++20 only: a lazy, unbounded std::ranges view of poisson_random_variate_integer variates, eg.
+//
+//	for(uint32_t x : poisson_view(seed,lambda) | std::views::take(1000)) ...
+//
+// The view owns a copy of the seed and fills a block of variates at a time with
+// poisson_random_variate_integer_fill, so the values are the same as calling
+// poisson_random_variate_integer repeatedly with that seed. Like std::ranges::istream_view
+// it is single pass: iterators refer back into the view.
+
+#include "poisson_random_variate_integer.h"
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+
+class poisson_view : public std::ranges::view_interface<poisson_view> {
+public:
+	static constexpr size_t BLOCK=64;
+
+	class iterator {
+	public:
+		using iterator_concept=std::input_iterator_tag;
+		using value_type=uint32_t;
+		using difference_type=std::ptrdiff_t;
+
+		iterator()=default;
+		explicit iterator(poisson_view* parent) : parent(parent) {}
+		iterator(iterator&&)=default;
+		iterator& operator=(iterator&&)=default;
+
+		uint32_t operator*() const {
+			return parent->buffer[parent->pos];
+		}
+		iterator& operator++() {
+			if(++parent->pos==BLOCK) {
+				parent->refill();
+			}
+			return *this;
+		}
+		void operator++(int) {
+			++*this;
+		}
+		friend bool operator==(const iterator&, std::default_sentinel_t) {
+			return false;
+		}
+	private:
+		poisson_view* parent=nullptr;
+	};
+
+	poisson_view()=default;
+	poisson_view(uint64_t seed, int64_t lambda) : seed(seed), lambda(lambda) {}
+
+	iterator begin() {
+		if(pos==BLOCK) {
+			refill();
+		}
+		return iterator(this);
+	}
+	std::default_sentinel_t end() const noexcept {
+		return std::default_sentinel;
+	}
+
+private:
+	void refill() {
+		poisson_random_variate_integer_fill(&seed,lambda,buffer.data(),BLOCK);
+		pos=0;
+	}
+
+	uint64_t seed=0;
+	int64_t lambda=0;
+	size_t pos=BLOCK;
+	std::array<uint32_t,BLOCK> buffer;
+};
+
+#endif // POISSON_RANDOM_VARIATE_VIEW_H